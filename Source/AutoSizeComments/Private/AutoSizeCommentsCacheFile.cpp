@@ -11,14 +11,20 @@
 #include "GeneralProjectSettings.h"
 #include "JsonObjectConverter.h"
 #include "AssetRegistry/AssetRegistryModule.h"
-#include "AssetRegistry/AssetRegistryState.h"
+#include "Async/Async.h"
 #include "EdGraph/EdGraph.h"
 #include "EdGraph/EdGraphNode.h"
+#include "Hash/CityHash.h"
+#include "HAL/FileManager.h"
 #include "HAL/PlatformFileManager.h"
 #include "Interfaces/IPluginManager.h"
 #include "Misc/CoreDelegates.h"
+#include "Misc/Crc.h"
 #include "Misc/FileHelper.h"
 #include "Misc/LazySingleton.h"
+#include "Misc/PackageName.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 #include "UObject/MetaData.h"
 
 static FName NAME_ASC_GRAPH_DATA = FName("ASCGraphData");
@@ -38,9 +44,11 @@ void FAutoSizeCommentsCacheFile::Init()
 	if (FAssetRegistryModule* AssetRegistryModule = FModuleManager::GetModulePtr<FAssetRegistryModule>(TEXT("AssetRegistry")))
 	{
 		AssetRegistryModule->Get().OnFilesLoaded().AddRaw(this, &FAutoSizeCommentsCacheFile::LoadCacheFromFile);
+		AssetRegistryModule->Get().OnAssetRemoved().AddRaw(this, &FAutoSizeCommentsCacheFile::OnAssetRemoved);
+		AssetRegistryModule->Get().OnAssetRenamed().AddRaw(this, &FAutoSizeCommentsCacheFile::OnAssetRenamed);
 	}
 
-	FCoreDelegates::OnPreExit.AddRaw(this, &FAutoSizeCommentsCacheFile::SaveCacheToFile);
+	FCoreDelegates::OnPreExit.AddRaw(this, &FAutoSizeCommentsCacheFile::OnPreExit);
 	FCoreUObjectDelegates::OnAssetLoaded.AddRaw(this, &FAutoSizeCommentsCacheFile::OnObjectLoaded);
 }
 
@@ -49,302 +57,1643 @@ void FAutoSizeCommentsCacheFile::Cleanup()
 	if (FAssetRegistryModule* AssetRegistryModule = FModuleManager::GetModulePtr<FAssetRegistryModule>(TEXT("AssetRegistry")))
 	{
 		AssetRegistryModule->Get().OnFilesLoaded().RemoveAll(this);
+		AssetRegistryModule->Get().OnAssetRemoved().RemoveAll(this);
+		AssetRegistryModule->Get().OnAssetRenamed().RemoveAll(this);
 	}
 
 	FCoreDelegates::OnPreExit.RemoveAll(this);
 	FCoreUObjectDelegates::OnAssetLoaded.RemoveAll(this);
+
+	if (CleanupTickerHandle.IsValid())
+	{
+#if ASC_UE_VERSION_OR_LATER(5, 0)
+		FTSTicker::GetCoreTicker().RemoveTicker(CleanupTickerHandle);
+#else
+		FTicker::GetCoreTicker().RemoveTicker(CleanupTickerHandle);
+#endif
+		CleanupTickerHandle.Reset();
+	}
+
+	PackagesToCleanup.Reset();
+	ShardFilesToCleanup.Reset();
+
+	FlushPendingSave();
+}
+
+void FAutoSizeCommentsCacheFile::LoadCacheFromFile()
+{
+	if (bHasLoaded)
+	{
+		return;
+	}
+
+	bHasLoaded = true;
+
+	// with per package files, only a single cache file left over from before needs loading here (to be migrated on the next save)
+	bCacheDataSplit = UAutoSizeCommentsSettings::Get().bSplitCacheFilePerPackage;
+	if (LoadCacheData(CacheData))
+	{
+		// rewrite the cache if it was loaded from another location or format
+		bAllPackagesDirty = bCacheDataSplit || !FPlatformFileManager::Get().GetPlatformFile().FileExists(*GetCachePath());
+
+		// a package file is newer than a single cache file which was left over
+		if (bCacheDataSplit)
+		{
+			IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+			for (auto It = CacheData.PackageData.CreateIterator(); It; ++It)
+			{
+				if (PlatformFile.FileExists(*GetShardPath(It.Key(), EASCCacheFileFormat::Json)) || PlatformFile.FileExists(*GetShardPath(It.Key(), EASCCacheFileFormat::Binary)))
+				{
+					It.RemoveCurrent();
+				}
+			}
+		}
+	}
+	else if (!bCacheDataSplit)
+	{
+		LoadAllShards(CacheData);
+		bAllPackagesDirty = CacheData.PackageData.Num() > 0;
+	}
+
+	// changes made after the cache files were last written
+	ReplayJournals(CacheData, true);
+
+	if (bCacheDataSplit)
+	{
+		LoadShardIndex();
+	}
+
+	CleanupFiles();
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+	AssetRegistry.OnFilesLoaded().RemoveAll(this);
+}
+
+FASCCacheData FAutoSizeCommentsCacheFile::CreateCacheFromFile()
+{
+	FASCCacheData NewCacheData;
+	if (!LoadCacheData(NewCacheData))
+	{
+		LoadAllShards(NewCacheData);
+	}
+
+	ReplayJournals(NewCacheData, false);
+
+	return NewCacheData;
+}
+
+void FAutoSizeCommentsCacheFile::InitMetaData()
+{
+	
+}
+
+void FAutoSizeCommentsCacheFile::SyncSplitCacheFileMode()
+{
+	const bool bSplitCacheFile = UAutoSizeCommentsSettings::Get().bSplitCacheFilePerPackage;
+	if (!bHasLoaded || bSplitCacheFile == bCacheDataSplit)
+	{
+		return;
+	}
+
+	// the save in flight was written in the old layout
+	FlushPendingSave();
+
+	bCacheDataSplit = bSplitCacheFile;
+
+	if (bSplitCacheFile)
+	{
+		// the cache data holds every package, any package file is older and must not be loaded over it
+		TArray<FString> ShardFiles;
+		FindShardFiles(ShardFiles);
+
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		for (const FString& ShardFile : ShardFiles)
+		{
+			PlatformFile.DeleteFile(*ShardFile);
+		}
+
+		// the next save writes every package into the index
+		ShardIndex.Reset();
+		bShardIndexComplete = true;
+		bShardIndexDirty = true;
+	}
+	else
+	{
+		// only the packages used this session have been loaded, the single cache file needs all of them
+		FASCCacheData ShardData;
+		LoadAllShards(ShardData);
+
+		for (auto& Elem : ShardData.PackageData)
+		{
+			if (!LoadedShards.Contains(Elem.Key) && !CacheData.PackageData.Contains(Elem.Key))
+			{
+				CacheData.PackageData.Add(Elem.Key, MoveTemp(Elem.Value));
+			}
+		}
+	}
+
+	LoadedShards.Reset();
+	ShardFilesToCleanup.Reset();
+	bAllPackagesDirty = true;
+}
+
+void FAutoSizeCommentsCacheFile::SaveCacheToFile()
+{
+	if (UAutoSizeCommentsSettings::Get().CacheSaveMethod != EASCCacheSaveMethod::File)
+	{
+		return;
+	}
+
+	// Don't save the cache while cooking 
+	if (GIsCookerLoadingPackage)
+	{
+		return;
+	}
+
+	SyncSplitCacheFileMode();
+
+	// keep the saves in order so an older snapshot can't overwrite a newer one, this also marks what it failed to write dirty again
+	FlushPendingSave();
+
+	// only graphs which had nodes removed can have data to cleanup
+	for (UEdGraph* Graph : FAutoSizeCommentGraphHandler::Get().GetActiveGraphs())
+	{
+		FASCGraphData& CacheGraphData = GetGraphData(Graph);
+		if (CacheGraphData.bNeedsCleanup)
+		{
+			CacheGraphData.bNeedsCleanup = false;
+			if (CacheGraphData.CleanupGraph(Graph))
+			{
+				MarkDirty(Graph);
+			}
+		}
+	}
+
+	if (DirtyPackages.Num() == 0 && !bAllPackagesDirty)
+	{
+		UE_LOG(LogAutoSizeComments, Verbose, TEXT("Skipped saving cache, nothing has changed"));
+		return;
+	}
+
+	const UAutoSizeCommentsSettings& Settings = UAutoSizeCommentsSettings::Get();
+
+	// the changes are already in the journal, only fold it into the cache files once it is large
+	if (ShouldUseJournal() && !bAllPackagesDirty)
+	{
+		const int64 JournalSize = GetJournalSize();
+		if (JournalSize < static_cast<int64>(Settings.CacheJournalCompactSize) * 1024)
+		{
+			UE_LOG(LogAutoSizeComments, Verbose, TEXT("Skipped saving cache, the journal is %lld bytes"), JournalSize);
+			return;
+		}
+	}
+
+	const EASCCacheFileFormat Format = Settings.CacheFileFormat;
+	const EASCCacheFileFormat OtherFormat = Format == EASCCacheFileFormat::Binary ? EASCCacheFileFormat::Json : EASCCacheFileFormat::Binary;
+	const FString CachePath = GetCachePath();
+
+	FASCCacheSaveJob Job;
+	Job.Format = Format;
+	Job.FormatName = StaticEnum<EASCCacheFileFormat>()->GetNameStringByValue(static_cast<int64>(Format));
+	Job.OtherFormatName = StaticEnum<EASCCacheFileFormat>()->GetNameStringByValue(static_cast<int64>(OtherFormat));
+	Job.bPrettyPrintJson = Settings.bPrettyPrintCommentCacheJSON;
+	Job.bCompareOtherFormat = UE_LOG_ACTIVE(LogAutoSizeComments, Verbose);
+
+	if (Settings.bSplitCacheFilePerPackage)
+	{
+		// only write the packages that changed, unless migrating from the single cache file (all in memory)
+		TArray<FName> PackagesToSave;
+		if (bAllPackagesDirty)
+		{
+			CacheData.PackageData.GetKeys(PackagesToSave);
+		}
+
+		for (FName PackageName : DirtyPackages)
+		{
+			PackagesToSave.AddUnique(PackageName);
+		}
+
+		for (FName PackageName : PackagesToSave)
+		{
+			// removed packages (or packages without any data left) have their file deleted
+			bool bHasData = false;
+			if (const FASCPackageData* PackageData = CacheData.PackageData.Find(PackageName))
+			{
+				for (const auto& GraphElem : PackageData->GraphData)
+				{
+					if (!GraphElem.Value.IsEmpty())
+					{
+						bHasData = true;
+						break;
+					}
+				}
+			}
+
+			const FString ShardPath = GetShardPath(PackageName, Format);
+			if (bHasData)
+			{
+				FASCCacheSaveJob::FFile& File = Job.FilesToWrite.AddDefaulted_GetRef();
+				File.Path = ShardPath;
+				File.PackageName = PackageName;
+				File.Data.PackageData.Add(PackageName, CacheData.PackageData.FindChecked(PackageName));
+
+				bool bAlreadyInIndex = false;
+				ShardIndex.Add(PackageName, &bAlreadyInIndex);
+				bShardIndexDirty |= !bAlreadyInIndex;
+			}
+			else
+			{
+				Job.FilesToDelete.Add(ShardPath);
+				bShardIndexDirty |= ShardIndex.Remove(PackageName) > 0;
+			}
+
+			Job.FilesToDelete.Add(GetShardPath(PackageName, OtherFormat));
+		}
+
+		// an index missing some package files would hide them from the cleanup, so only write it once complete
+		if (bShardIndexComplete && bShardIndexDirty)
+		{
+			Job.ShardIndexPath = GetShardIndexPath();
+			for (FName PackageName : ShardIndex)
+			{
+				Job.ShardIndex.Add(PackageName.ToString());
+			}
+
+			bShardIndexDirty = false;
+		}
+
+		// a single cache file left over would be older than the package files
+		Job.FilesToDelete.Add(GetCachePathForFormat(CachePath, EASCCacheFileFormat::Json));
+		Job.FilesToDelete.Add(GetCachePathForFormat(CachePath, EASCCacheFileFormat::Binary));
+	}
+	else
+	{
+		FASCCacheSaveJob::FFile& File = Job.FilesToWrite.AddDefaulted_GetRef();
+		File.Path = CachePath;
+		File.Data = CacheData;
+
+		// the cache is migrated once it has been saved in the new format, remove the old file so it can't be loaded later
+		Job.FilesToDelete.Add(GetCachePathForFormat(CachePath, OtherFormat));
+
+		// the package files have been migrated into the single cache file
+		if (bAllPackagesDirty)
+		{
+			FindShardFiles(Job.FilesToDelete);
+			Job.FilesToDelete.Add(GetShardIndexPath());
+
+			ShardIndex.Reset();
+			bShardIndexComplete = false;
+			bShardIndexDirty = false;
+		}
+	}
+
+	DirtyPackages.Reset();
+	bAllPackagesDirty = false;
+
+	// the journal's changes are in this save, move it aside so new changes go to a new journal
+	JournalHandle.Reset();
+	Job.JournalsToDelete = MoveTemp(ReplayedJournals);
+	ReplayedJournals.Reset();
+
+	const FString JournalPath = GetJournalPath();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	FString CompactingJournalPath;
+	if (PlatformFile.FileExists(*JournalPath) && ASCCacheJournal::MoveAside(JournalPath, CompactingJournalPath))
+	{
+		Job.JournalsToDelete.Add(CompactingJournalPath);
+	}
+
+	PendingSave = Async(EAsyncExecution::ThreadPool, [Job = MoveTemp(Job)]()
+	{
+		return Job.Run();
+	});
+}
+
+void FAutoSizeCommentsCacheFile::FlushPendingSave()
+{
+	if (PendingSave.IsValid())
+	{
+		DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FAutoSizeCommentsCacheFile::FlushPendingSave"), STAT_ASC_FlushPendingSave, STATGROUP_AutoSizeComments);
+		const FASCCacheSaveJob::FResult Result = PendingSave.Get();
+		PendingSave = TFuture<FASCCacheSaveJob::FResult>();
+
+		// write the failed files again on the next save, their kept journals are only deleted once that succeeds
+		for (FName PackageName : Result.FailedPackages)
+		{
+			if (PackageName.IsNone())
+			{
+				bAllPackagesDirty = true;
+			}
+			else
+			{
+				DirtyPackages.Add(PackageName);
+			}
+		}
+
+		ReplayedJournals.Append(Result.KeptJournals);
+		bShardIndexDirty |= Result.bFailedShardIndex;
+	}
+}
+
+FASCCacheSaveJob::FResult FASCCacheSaveJob::Run() const
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	FResult Result;
+
+	int32 NumFiles = 0;
+	int64 NumBytes = 0;
+	for (const FFile& File : FilesToWrite)
+	{
+		TArray<uint8> FileData;
+		if (FAutoSizeCommentsCacheFile::SerializeCacheData(File.Data, Format, FileData, bPrettyPrintJson) && FAutoSizeCommentsCacheFile::WriteFileAtomic(File.Path, FileData))
+		{
+			++NumFiles;
+			NumBytes += FileData.Num();
+		}
+		else
+		{
+			UE_LOG(LogAutoSizeComments, Warning, TEXT("Failed to save cache to %s"), *FPaths::ConvertRelativePathToFull(File.Path));
+			Result.FailedPackages.Add(File.PackageName);
+		}
+	}
+
+	if (!ShardIndexPath.IsEmpty())
+	{
+		const FString IndexString = FString::Join(ShardIndex, TEXT("\n"));
+		const FTCHARToUTF8 IndexUtf8(*IndexString);
+		const TArray<uint8> IndexBytes(reinterpret_cast<const uint8*>(IndexUtf8.Get()), IndexUtf8.Length());
+		if (!FAutoSizeCommentsCacheFile::WriteFileAtomic(ShardIndexPath, IndexBytes))
+		{
+			UE_LOG(LogAutoSizeComments, Warning, TEXT("Failed to save cache package index to %s"), *FPaths::ConvertRelativePathToFull(ShardIndexPath));
+			Result.bFailedShardIndex = true;
+		}
+	}
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	for (const FString& FileToDelete : FilesToDelete)
+	{
+		if (PlatformFile.FileExists(*FileToDelete) && PlatformFile.DeleteFile(*FileToDelete))
+		{
+			UE_LOG(LogAutoSizeComments, Log, TEXT("Removed old cache file %s"), *FPaths::ConvertRelativePathToFull(FileToDelete));
+		}
+	}
+
+	// keep the journals to be replayed on the next load if their changes failed to save
+	if (NumFiles == FilesToWrite.Num())
+	{
+		for (const FString& Journal : JournalsToDelete)
+		{
+			PlatformFile.DeleteFile(*Journal);
+		}
+	}
+	else if (JournalsToDelete.Num() > 0)
+	{
+		UE_LOG(LogAutoSizeComments, Warning, TEXT("Kept %d cache journals as the cache failed to save"), JournalsToDelete.Num());
+		Result.KeptJournals = JournalsToDelete;
+	}
+
+	const double TimeTaken = (FPlatformTime::Seconds() - StartTime) * 1000.0f;
+	const FString SavePath = FilesToWrite.Num() == 1 ? FPaths::ConvertRelativePathToFull(FilesToWrite[0].Path) : FString::Printf(TEXT("%d files"), NumFiles);
+	UE_LOG(LogAutoSizeComments, Log, TEXT("Saved cache (%s, %lld bytes) to %s took %6.2fms"), *FormatName, NumBytes, *SavePath, TimeTaken);
+
+	// compare against the other format
+	if (bCompareOtherFormat)
+	{
+		const EASCCacheFileFormat OtherFormat = Format == EASCCacheFileFormat::Binary ? EASCCacheFileFormat::Json : EASCCacheFileFormat::Binary;
+		const double CompareStartTime = FPlatformTime::Seconds();
+
+		int64 NumOtherBytes = 0;
+		for (const FFile& File : FilesToWrite)
+		{
+			TArray<uint8> OtherFileData;
+			FAutoSizeCommentsCacheFile::SerializeCacheData(File.Data, OtherFormat, OtherFileData, bPrettyPrintJson);
+			NumOtherBytes += OtherFileData.Num();
+		}
+
+		const double CompareTimeTaken = (FPlatformTime::Seconds() - CompareStartTime) * 1000.0f;
+		UE_LOG(LogAutoSizeComments, Verbose, TEXT("Serializing the cache as %s would be %lld bytes and took %6.2fms"), *OtherFormatName, NumOtherBytes, CompareTimeTaken);
+	}
+
+	return Result;
+}
+
+void FAutoSizeCommentsCacheFile::DeleteCache()
+{
+	// don't let a save in flight write the files back
+	FlushPendingSave();
+
+	CacheData.PackageData.Reset();
+
+	LoadedShards.Reset();
+	DirtyPackages.Reset();
+	bAllPackagesDirty = false;
+
+	ShardIndex.Reset();
+	bShardIndexComplete = true;
+	bShardIndexDirty = false;
+	ShardFilesToCleanup.Reset();
+
+	JournalHandle.Reset();
+	ReplayedJournals.Reset();
+	bJournalFailed = false;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (PlatformFile.DeleteDirectoryRecursively(*GetShardDirectory()))
+	{
+		UE_LOG(LogAutoSizeComments, Log, TEXT("Deleted per package cache files at %s"), *GetShardDirectory());
+	}
+
+	for (const EASCCacheFileFormat Format : { EASCCacheFileFormat::Json, EASCCacheFileFormat::Binary })
+	{
+		const FString ProjectCachePath = GetCachePathForFormat(GetProjectCachePath(), Format);
+		const FString PluginCachePath = GetCachePathForFormat(GetPluginCachePath(), Format);
+
+		if (PlatformFile.DeleteFile(*ProjectCachePath))
+		{
+			UE_LOG(LogAutoSizeComments, Log, TEXT("Deleted project cache file at %s"), *ProjectCachePath);
+		}
+
+		if (PlatformFile.DeleteFile(*PluginCachePath))
+		{
+			UE_LOG(LogAutoSizeComments, Log, TEXT("Deleted plugin cache file at %s"), *PluginCachePath);
+		}
+	}
+
+	for (const FString& CachePath : { GetProjectCachePath(), GetPluginCachePath() })
+	{
+		TArray<FString> JournalFiles;
+		FindJournalFiles(GetJournalPath(CachePath), JournalFiles);
+		for (const FString& JournalFile : JournalFiles)
+		{
+			if (PlatformFile.DeleteFile(*JournalFile))
+			{
+				UE_LOG(LogAutoSizeComments, Log, TEXT("Deleted cache journal at %s"), *JournalFile);
+			}
+		}
+	}
+}
+
+void FAutoSizeCommentsCacheFile::CleanupFiles()
+{
+	// only the packages in the cache need checking, instead of gathering every asset in the project
+	for (const auto& PackageElem : CacheData.PackageData)
+	{
+		QueuePackageCleanup(PackageElem.Key);
+	}
+
+	if (!bCacheDataSplit)
+	{
+		return;
+	}
+
+	// the package files are only loaded when used, so check the packages in the index to find the ones deleted while the editor was closed
+	if (bShardIndexComplete)
+	{
+		for (FName PackageName : ShardIndex)
+		{
+			QueuePackageCleanup(PackageName);
+		}
+
+		return;
+	}
+
+	// without an index (package files written by an older version), read the package names from the files on later ticks
+	FindShardFiles(ShardFilesToCleanup);
+	if (ShardFilesToCleanup.Num() > 0)
+	{
+		StartCleanupTicker();
+	}
+	else
+	{
+		bShardIndexComplete = true;
+		bShardIndexDirty = true;
+	}
+}
+
+FString FAutoSizeCommentsCacheFile::GetShardIndexPath()
+{
+	return GetShardDirectory() / TEXT("Packages.txt");
+}
+
+void FAutoSizeCommentsCacheFile::LoadShardIndex()
+{
+	ShardIndex.Reset();
+	bShardIndexDirty = false;
+
+	TArray<FString> PackageNames;
+	bShardIndexComplete = FFileHelper::LoadFileToStringArray(PackageNames, *GetShardIndexPath());
+	for (const FString& PackageName : PackageNames)
+	{
+		if (!PackageName.IsEmpty())
+		{
+			ShardIndex.Add(FName(*PackageName));
+		}
+	}
+}
+
+void FAutoSizeCommentsCacheFile::QueuePackageCleanup(FName PackageName)
+{
+	if (UAutoSizeCommentsSettings::Get().bDisablePackageCleanup)
+	{
+		return;
+	}
+
+	PackagesToCleanup.Add(PackageName);
+	StartCleanupTicker();
+}
+
+void FAutoSizeCommentsCacheFile::StartCleanupTicker()
+{
+	if (!CleanupTickerHandle.IsValid())
+	{
+#if ASC_UE_VERSION_OR_LATER(5, 0)
+		CleanupTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FAutoSizeCommentsCacheFile::TickPackageCleanup));
+#else
+		CleanupTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FAutoSizeCommentsCacheFile::TickPackageCleanup));
+#endif
+	}
+}
+
+bool FAutoSizeCommentsCacheFile::TickPackageCleanup(float DeltaTime)
+{
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+
+	// wait for the asset registry to know about every package
+	if (AssetRegistry.IsLoadingAssets())
+	{
+		return true;
+	}
+
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FAutoSizeCommentsCacheFile::TickPackageCleanup"), STAT_ASC_TickPackageCleanup, STATGROUP_AutoSizeComments);
+
+	// check as many packages as fit in the time slice
+	constexpr double TimeSlice = 0.001;
+	const double EndTime = FPlatformTime::Seconds() + TimeSlice;
+
+	const EASCCacheFileFormat Format = UAutoSizeCommentsSettings::Get().CacheFileFormat;
+	const EASCCacheFileFormat OtherFormat = Format == EASCCacheFileFormat::Binary ? EASCCacheFileFormat::Json : EASCCacheFileFormat::Binary;
+	const bool bSplitCacheFile = bCacheDataSplit;
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	// read the package names into the index first, but not while a save may be writing the same files
+	const bool bSaveInFlight = PendingSave.IsValid() && !PendingSave.IsReady();
+	while (ShardFilesToCleanup.Num() > 0 && !bSaveInFlight)
+	{
+		const FString ShardFile = ShardFilesToCleanup.Pop(false);
+		const EASCCacheFileFormat ShardFormat = FPaths::GetExtension(ShardFile) == TEXT("ascbin") ? EASCCacheFileFormat::Binary : EASCCacheFileFormat::Json;
+
+		FASCCacheData ShardData;
+		if (LoadCacheFile(ShardFile, ShardFormat, ShardData, ELogVerbosity::Verbose, false))
+		{
+			for (const auto& PackageElem : ShardData.PackageData)
+			{
+				ShardIndex.Add(PackageElem.Key);
+				QueuePackageCleanup(PackageElem.Key);
+			}
+		}
+
+		// the index can be written once every file has been read
+		if (ShardFilesToCleanup.Num() == 0)
+		{
+			bShardIndexComplete = true;
+			bShardIndexDirty = true;
+		}
+
+		if (FPlatformTime::Seconds() >= EndTime)
+		{
+			return true;
+		}
+	}
+
+	TArray<FAssetData> Assets;
+	for (auto It = PackagesToCleanup.CreateIterator(); It; ++It)
+	{
+		const FName PackageName = *It;
+		It.RemoveCurrent();
+
+		Assets.Reset();
+		AssetRegistry.GetAssetsByPackageName(PackageName, Assets);
+		if (Assets.Num() == 0)
+		{
+			// packages which are not loaded may still have a package file to remove
+			const bool bHasData = CacheData.PackageData.Remove(PackageName) > 0 || (bSplitCacheFile &&
+				(PlatformFile.FileExists(*GetShardPath(PackageName, Format)) || PlatformFile.FileExists(*GetShardPath(PackageName, OtherFormat))));
+
+			// don't load the old package file if a package is created with the same name
+			LoadedShards.Add(PackageName);
+
+			if (bHasData)
+			{
+				UE_LOG(LogAutoSizeComments, Verbose, TEXT("Removed cache data for missing package %s"), *PackageName.ToString());
+				MarkPackageRemoved(PackageName);
+			}
+			else
+			{
+				// the package file is already gone, the save which removes it from the index won't see it
+				bShardIndexDirty |= ShardIndex.Remove(PackageName) > 0;
+			}
+		}
+
+		if (FPlatformTime::Seconds() >= EndTime)
+		{
+			break;
+		}
+	}
+
+	if (PackagesToCleanup.Num() == 0 && ShardFilesToCleanup.Num() == 0)
+	{
+		CleanupTickerHandle.Reset();
+		return false;
+	}
+
+	return true;
+}
+
+void FAutoSizeCommentsCacheFile::OnAssetRemoved(const FAssetData& AssetData)
+{
+	// other assets may remain in the package, so check it once the asset registry has been updated
+	QueuePackageCleanup(AssetData.PackageName);
+}
+
+void FAutoSizeCommentsCacheFile::OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath)
+{
+	const FName OldPackageName(*FPackageName::ObjectPathToPackageName(OldObjectPath));
+	const FName NewPackageName = AssetData.PackageName;
+	if (OldPackageName == NewPackageName)
+	{
+		return;
+	}
+
+	LoadPackageShard(OldPackageName);
+
+	FASCPackageData PackageData;
+	if (!CacheData.PackageData.RemoveAndCopyValue(OldPackageName, PackageData))
+	{
+		return;
+	}
+
+	MarkPackageRemoved(OldPackageName);
+
+	// the graphs keep their guids, so the data only needs to move to the new package name
+	LoadedShards.Add(NewPackageName);
+	DirtyPackages.Add(NewPackageName);
+
+	const FASCPackageData& NewPackageData = CacheData.PackageData.Add(NewPackageName, MoveTemp(PackageData));
+	if (ShouldUseJournal())
+	{
+		for (const auto& GraphElem : NewPackageData.GraphData)
+		{
+			AppendGraphJournalRecord(NewPackageName, GraphElem.Key, GraphElem.Value);
+		}
+	}
+
+	UE_LOG(LogAutoSizeComments, Verbose, TEXT("Moved cache data from renamed package %s to %s"), *OldPackageName.ToString(), *NewPackageName.ToString());
+}
+
+FASCCommentData& FAutoSizeCommentsCacheFile::GetCommentData(UEdGraphNode_Comment* Comment)
+{
+	return GetCommentData(static_cast<UEdGraphNode*>(Comment));
+}
+
+void FAutoSizeCommentsCacheFile::UpdateNodesUnderComment(UEdGraphNode_Comment* Comment)
+{
+	if (GetCommentData(Comment).UpdateNodesUnderComment(Comment))
+	{
+		MarkCommentDirty(Comment);
+	}
+}
+
+void FAutoSizeCommentsCacheFile::MarkNeedsCleanup(UEdGraph* Graph)
+{
+	if (!Graph)
+	{
+		return;
+	}
+
+	if (FASCGraphData* GraphData = FindCacheFileGraphData(Graph))
+	{
+		GraphData->bNeedsCleanup = true;
+	}
+}
+
+FASCGraphData& FAutoSizeCommentsCacheFile::GetGraphData(UEdGraph* Graph)
+{
+	check(Graph);
+
+	// load from cache file class
+	if (UAutoSizeCommentsSettings::Get().CacheSaveMethod == EASCCacheSaveMethod::File)
+	{
+		FASCGraphData& GraphData = GetCacheFileGraphData(Graph);
+		if (GraphData.bInitialized)
+		{
+			return GraphData;
+		}
+
+		GraphData.bInitialized = true;
+
+		// if we have no data, try loading from the package's meta data
+		if (GraphData.IsEmpty())
+		{
+			if (GraphData.LoadFromPackageMetaData(Graph))
+			{
+				MarkDirty(Graph);
+			}
+
+			GraphData.bInitialized = true;
+		}
+
+		return GraphData;
+	}
+
+	// load and store from package metadata
+	{
+		FASCGraphHandlerData& GraphHandlerData = FAutoSizeCommentGraphHandler::Get().GetGraphHandlerData(Graph);
+		FASCGraphData& GraphData = GraphHandlerData.GraphCacheData;
+		if (GraphData.bInitialized)
+		{
+			return GraphData;
+		}
+
+		if (GraphData.LoadFromPackageMetaData(Graph))
+		{
+			GraphData.bInitialized = true;
+			return GraphData;
+		}
+
+		// we failed to load from the package meta data, load from the cache file
+		GraphData = GetCacheFileGraphData(Graph);
+		GraphData.bInitialized = true;
+
+		// write any data we got from the cache file to the meta data
+		GraphData.SaveToPackageMetaData(Graph);
+
+		return GraphData;
+	}
+}
+
+bool FAutoSizeCommentsCacheFile::RemoveGraphData(UEdGraph* Graph)
+{
+	UPackage* Package = Graph->GetOutermost();
+	LoadPackageShard(Package->GetFName());
+	FASCPackageData& PackageData = CacheData.PackageData.FindOrAdd(Package->GetFName());
+	if (PackageData.GraphData.Remove(Graph->GraphGuid) > 0)
+	{
+		MarkDirty(Graph);
+		return true;
+	}
+
+	return false;
+}
+
+FASCPackageData* FAutoSizeCommentsCacheFile::FindPackageData(UPackage* Package)
+{
+	return CacheData.PackageData.Find(Package->GetFName());
+}
+
+void FAutoSizeCommentsCacheFile::ClearPackageMetaData(UEdGraph* Graph)
+{
+	if (UPackage* AssetPackage = Graph->GetPackage())
+	{
+		if (FASCMetaData* MetaData = FASCUtils::GetPackageMetaData(AssetPackage))
+		{
+			MetaData->RemoveValue(Graph, NAME_ASC_GRAPH_DATA);
+		}
+	}
+}
+
+FString FAutoSizeCommentsCacheFile::GetProjectCachePath(bool bFullPath)
+{
+	const FString CachePath = FPaths::ProjectDir() / TEXT("Saved") / TEXT("AutoSizeComments") / TEXT("AutoSizeCommentsCache.json");
+	return GetCachePathForFormat(CachePath, UAutoSizeCommentsSettings::Get().CacheFileFormat);
+}
+
+FString FAutoSizeCommentsCacheFile::GetPluginCachePath(bool bFullPath)
+{
+	FString PluginDir = IPluginManager::Get().FindPlugin("AutoSizeComments")->GetBaseDir();
+
+	if (bFullPath)
+	{
+		PluginDir = FPaths::ConvertRelativePathToFull(PluginDir);
+	}
+
+	const UGeneralProjectSettings* ProjectSettings = GetDefault<UGeneralProjectSettings>();
+	const FGuid& ProjectID = ProjectSettings->ProjectID;
+
+	return GetCachePathForFormat(PluginDir + "/ASCCache/" + ProjectID.ToString() + ".json", UAutoSizeCommentsSettings::Get().CacheFileFormat);
+}
+
+FString FAutoSizeCommentsCacheFile::GetCachePath(bool bFullPath)
+{
+	const bool bIsProject = UAutoSizeCommentsSettings::Get().CacheSaveLocation == EASCCacheSaveLocation::Project;
+	return bIsProject ? GetProjectCachePath(bFullPath) : GetPluginCachePath(bFullPath);
+}
+
+FString FAutoSizeCommentsCacheFile::GetAlternateCachePath(bool bFullPath)
+{
+	const bool bIsProject = UAutoSizeCommentsSettings::Get().CacheSaveLocation == EASCCacheSaveLocation::Project;
+	return bIsProject ? GetPluginCachePath(bFullPath) : GetProjectCachePath(bFullPath);
+}
+
+FString FAutoSizeCommentsCacheFile::GetCachePathForFormat(const FString& CachePath, EASCCacheFileFormat Format)
+{
+	return FPaths::ChangeExtension(CachePath, Format == EASCCacheFileFormat::Binary ? TEXT("ascbin") : TEXT("json"));
+}
+
+namespace ASCCacheBinaryFormat
+{
+	/*
+	 * Layout (counts are packed ints):
+	 *	uint32 Magic, uint32 Version
+	 *	NumPackages, FString PackageName[NumPackages]
+	 *	for each package (same order as the names):
+	 *		NumGraphs, for each graph:
+	 *			FGuid GraphGuid, NumComments, for each comment:
+	 *				FGuid CommentGuid, uint8 Flags, NumNodes, FGuid NodeGuid[NumNodes]
+	 */
+	constexpr uint32 Magic = 0x43435341; // ASCC
+	constexpr uint32 Version = 1;
+
+	constexpr uint8 CommentFlag_Header = 1 << 0;
+	constexpr uint8 CommentFlag_Initialized = 1 << 1;
+
+	/** Guard against allocating for a count which can't fit in the remaining data */
+	bool IsValidCount(FArchive& Ar, uint32 Count, int64 MinElementSize)
+	{
+		return !Ar.IsError() && static_cast<int64>(Count) * MinElementSize <= Ar.TotalSize() - Ar.Tell();
+	}
+
+	void WriteComment(FArchive& Ar, const FGuid& Guid, const FASCCommentData& CommentData)
+	{
+		FGuid CommentGuid = Guid;
+		uint8 Flags = (CommentData.IsHeader() ? CommentFlag_Header : 0) | (CommentData.HasBeenInitialized() ? CommentFlag_Initialized : 0);
+		Ar << CommentGuid << Flags;
+
+		uint32 NumNodes = CommentData.NodeGuids.Num();
+		Ar.SerializeIntPacked(NumNodes);
+		for (FGuid NodeGuid : CommentData.NodeGuids)
+		{
+			Ar << NodeGuid;
+		}
+	}
+
+	bool ReadComment(FArchive& Ar, FGuid& OutGuid, FASCCommentData& OutCommentData)
+	{
+		uint8 Flags = 0;
+		Ar << OutGuid << Flags;
+
+		uint32 NumNodes = 0;
+		Ar.SerializeIntPacked(NumNodes);
+		if (!IsValidCount(Ar, NumNodes, sizeof(FGuid)))
+		{
+			return false;
+		}
+
+		OutCommentData.SetHeader((Flags & CommentFlag_Header) != 0);
+		OutCommentData.SetInitialized((Flags & CommentFlag_Initialized) != 0);
+		OutCommentData.NodeGuids.SetNum(NumNodes);
+		for (FGuid& NodeGuid : OutCommentData.NodeGuids)
+		{
+			Ar << NodeGuid;
+		}
+
+		return !Ar.IsError();
+	}
+
+	void WriteGraph(FArchive& Ar, const FGuid& Guid, const FASCGraphData& GraphData)
+	{
+		FGuid GraphGuid = Guid;
+		Ar << GraphGuid;
+
+		uint32 NumComments = GraphData.CommentData.Num();
+		Ar.SerializeIntPacked(NumComments);
+		for (const auto& CommentElem : GraphData.CommentData)
+		{
+			WriteComment(Ar, CommentElem.Key, CommentElem.Value);
+		}
+	}
+
+	bool ReadGraph(FArchive& Ar, FGuid& OutGuid, FASCGraphData& OutGraphData)
+	{
+		Ar << OutGuid;
+
+		uint32 NumComments = 0;
+		Ar.SerializeIntPacked(NumComments);
+		if (!IsValidCount(Ar, NumComments, sizeof(FGuid) + 2))
+		{
+			return false;
+		}
+
+		OutGraphData.CommentData.Reserve(NumComments);
+		for (uint32 CommentIndex = 0; CommentIndex < NumComments; ++CommentIndex)
+		{
+			FGuid CommentGuid;
+			FASCCommentData CommentData;
+			if (!ReadComment(Ar, CommentGuid, CommentData))
+			{
+				return false;
+			}
+
+			OutGraphData.CommentData.Add(CommentGuid, MoveTemp(CommentData));
+		}
+
+		return !Ar.IsError();
+	}
+
+	void Write(const FASCCacheData& Data, TArray<uint8>& OutBytes)
+	{
+		FMemoryWriter Ar(OutBytes);
+
+		uint32 FileMagic = Magic;
+		uint32 FileVersion = Version;
+		Ar << FileMagic << FileVersion;
+
+		// string table
+		uint32 NumPackages = Data.PackageData.Num();
+		Ar.SerializeIntPacked(NumPackages);
+		for (const auto& PackageElem : Data.PackageData)
+		{
+			FString PackageName = PackageElem.Key.ToString();
+			Ar << PackageName;
+		}
+
+		for (const auto& PackageElem : Data.PackageData)
+		{
+			uint32 NumGraphs = PackageElem.Value.GraphData.Num();
+			Ar.SerializeIntPacked(NumGraphs);
+			for (const auto& GraphElem : PackageElem.Value.GraphData)
+			{
+				WriteGraph(Ar, GraphElem.Key, GraphElem.Value);
+			}
+		}
+	}
+
+	bool Read(const TArray<uint8>& Bytes, FASCCacheData& OutData)
+	{
+		FMemoryReader Ar(Bytes);
+
+		uint32 FileMagic = 0;
+		uint32 FileVersion = 0;
+		Ar << FileMagic << FileVersion;
+		if (Ar.IsError() || FileMagic != Magic || FileVersion > Version)
+		{
+			return false;
+		}
+
+		uint32 NumPackages = 0;
+		Ar.SerializeIntPacked(NumPackages);
+		if (!IsValidCount(Ar, NumPackages, sizeof(int32)))
+		{
+			return false;
+		}
+
+		TArray<FName> PackageNames;
+		PackageNames.Reserve(NumPackages);
+		for (uint32 i = 0; i < NumPackages && !Ar.IsError(); ++i)
+		{
+			FString PackageName;
+			Ar << PackageName;
+			PackageNames.Add(FName(*PackageName));
+		}
+
+		for (const FName& PackageName : PackageNames)
+		{
+			uint32 NumGraphs = 0;
+			Ar.SerializeIntPacked(NumGraphs);
+			if (!IsValidCount(Ar, NumGraphs, sizeof(FGuid)))
+			{
+				return false;
+			}
+
+			FASCPackageData& PackageData = OutData.PackageData.FindOrAdd(PackageName);
+			for (uint32 GraphIndex = 0; GraphIndex < NumGraphs; ++GraphIndex)
+			{
+				FGuid GraphGuid;
+				FASCGraphData GraphData;
+				if (!ReadGraph(Ar, GraphGuid, GraphData))
+				{
+					return false;
+				}
+
+				PackageData.GraphData.Add(GraphGuid, MoveTemp(GraphData));
+			}
+		}
+
+		return !Ar.IsError();
+	}
+}
+
+namespace ASCCacheJournal
+{
+	/*
+	 * Layout:
+	 *	uint32 Magic, uint32 Version
+	 *	for each record: uint32 PayloadSize, uint32 PayloadCrc, uint8 Payload[PayloadSize]
+	 * Payload: uint8 RecordType, FString PackageName, followed by
+	 *	Comment: FGuid GraphGuid, comment (as in ASCCacheBinaryFormat)
+	 *	Graph: graph (as in ASCCacheBinaryFormat), a graph without any comments is removed
+	 *	RemovePackage: nothing
+	 * A record cut short by a crash fails the size or crc check and ends the replay, the journal is then moved aside
+	 * on load so the next records are not appended after it.
+	 */
+	constexpr uint32 Magic = 0x4A435341; // ASCJ
+	constexpr uint32 Version = 1;
+	constexpr int64 RecordHeaderSize = sizeof(uint32) * 2;
+
+	enum class ERecordType : uint8
+	{
+		Comment,
+		Graph,
+		RemovePackage,
+	};
+
+	void WriteHeader(TArray<uint8>& OutBytes)
+	{
+		FMemoryWriter Ar(OutBytes);
+
+		uint32 FileMagic = Magic;
+		uint32 FileVersion = Version;
+		Ar << FileMagic << FileVersion;
+	}
+
+	void BeginPayload(FArchive& Ar, ERecordType Type, FName PackageName)
+	{
+		uint8 RecordType = static_cast<uint8>(Type);
+		FString PackageNameString = PackageName.ToString();
+		Ar << RecordType << PackageNameString;
+	}
+
+	void WriteRecord(const TArray<uint8>& Payload, TArray<uint8>& OutBytes)
+	{
+		FMemoryWriter Ar(OutBytes);
+
+		uint32 PayloadSize = Payload.Num();
+		uint32 PayloadCrc = FCrc::MemCrc32(Payload.GetData(), Payload.Num());
+		Ar << PayloadSize << PayloadCrc;
+		Ar.Serialize(const_cast<uint8*>(Payload.GetData()), Payload.Num());
+	}
+
+	bool ApplyRecord(const TArray<uint8>& Payload, FASCCacheData& Data, TFunctionRef<void(FName)> OnPackageChanged)
+	{
+		FMemoryReader Ar(Payload);
+
+		uint8 RecordType = 0;
+		FString PackageNameString;
+		Ar << RecordType << PackageNameString;
+		if (Ar.IsError())
+		{
+			return false;
+		}
+
+		const FName PackageName(*PackageNameString);
+		switch (static_cast<ERecordType>(RecordType))
+		{
+			case ERecordType::Comment:
+			{
+				FGuid GraphGuid;
+				Ar << GraphGuid;
+
+				FGuid CommentGuid;
+				FASCCommentData CommentData;
+				if (!ASCCacheBinaryFormat::ReadComment(Ar, CommentGuid, CommentData))
+				{
+					return false;
+				}
+
+				OnPackageChanged(PackageName);
+				Data.PackageData.FindOrAdd(PackageName).GraphData.FindOrAdd(GraphGuid).CommentData.Add(CommentGuid, MoveTemp(CommentData));
+				return true;
+			}
+			case ERecordType::Graph:
+			{
+				FGuid GraphGuid;
+				FASCGraphData GraphData;
+				if (!ASCCacheBinaryFormat::ReadGraph(Ar, GraphGuid, GraphData))
+				{
+					return false;
+				}
+
+				OnPackageChanged(PackageName);
+				FASCPackageData& PackageData = Data.PackageData.FindOrAdd(PackageName);
+				if (GraphData.IsEmpty())
+				{
+					PackageData.GraphData.Remove(GraphGuid);
+				}
+				else
+				{
+					PackageData.GraphData.Add(GraphGuid, MoveTemp(GraphData));
+				}
+
+				return true;
+			}
+			case ERecordType::RemovePackage:
+			{
+				OnPackageChanged(PackageName);
+				Data.PackageData.Remove(PackageName);
+				return true;
+			}
+			default:
+				return false;
+		}
+	}
+
+	/**
+	 * @param OutEndOffset the end of the last record applied, less than the file size if the journal ends in a torn record
+	 * @return the number of records applied, or INDEX_NONE if this is not a journal
+	 */
+	int32 Replay(const TArray<uint8>& Bytes, FASCCacheData& Data, TFunctionRef<void(FName)> OnPackageChanged, int64& OutEndOffset)
+	{
+		FMemoryReader Ar(Bytes);
+		OutEndOffset = 0;
+
+		uint32 FileMagic = 0;
+		uint32 FileVersion = 0;
+		Ar << FileMagic << FileVersion;
+		if (Ar.IsError() || FileMagic != Magic || FileVersion > Version)
+		{
+			return INDEX_NONE;
+		}
+
+		OutEndOffset = Ar.Tell();
+
+		int32 NumRecords = 0;
+		while (Ar.TotalSize() - Ar.Tell() >= RecordHeaderSize)
+		{
+			uint32 PayloadSize = 0;
+			uint32 PayloadCrc = 0;
+			Ar << PayloadSize << PayloadCrc;
+			if (PayloadSize > Ar.TotalSize() - Ar.Tell())
+			{
+				break;
+			}
+
+			const TArray<uint8> Payload(Bytes.GetData() + Ar.Tell(), PayloadSize);
+			Ar.Seek(Ar.Tell() + PayloadSize);
+
+			if (FCrc::MemCrc32(Payload.GetData(), Payload.Num()) != PayloadCrc || !ApplyRecord(Payload, Data, OnPackageChanged))
+			{
+				break;
+			}
+
+			++NumRecords;
+			OutEndOffset = Ar.Tell();
+		}
+
+		return NumRecords;
+	}
+
+	/** Rename the journal to a name ordered by the time it was moved, so a new journal is started */
+	bool MoveAside(const FString& JournalPath, FString& OutMovedPath)
+	{
+		OutMovedPath = FString::Printf(TEXT("%s_%020llu.ascjournal"), *FPaths::GetBaseFilename(JournalPath, false), FDateTime::UtcNow().GetTicks());
+		return FPlatformFileManager::Get().GetPlatformFile().MoveFile(*OutMovedPath, *JournalPath);
+	}
 }
 
-void FAutoSizeCommentsCacheFile::LoadCacheFromFile()
+void FAutoSizeCommentsCacheFile::MarkCommentDirty(UEdGraphNode* Comment)
 {
-	if (bHasLoaded)
+	// the package meta data is saved with the package
+	if (!Comment || UAutoSizeCommentsSettings::Get().CacheSaveMethod != EASCCacheSaveMethod::File)
 	{
 		return;
 	}
 
-	bHasLoaded = true;
-
-	const FString CachePath = GetCachePath();
-	const FString OldCachePath = GetAlternateCachePath();
+	UEdGraph* Graph = Comment->GetGraph();
+	const FName PackageName = Graph->GetOutermost()->GetFName();
+	DirtyPackages.Add(PackageName);
 
-	FString FileData;
-	if (FPlatformFileManager::Get().GetPlatformFile().FileExists(*CachePath))
+	if (ShouldUseJournal())
 	{
-		FFileHelper::LoadFileToString(FileData, *CachePath);
-
-		if (FJsonObjectConverter::JsonObjectStringToUStruct(FileData, &CacheData, 0, 0))
-		{
-			UE_LOG(LogAutoSizeComments, Log, TEXT("Loaded auto size comments cache: %s"), *GetCachePath(true));
-		}
-		else
+		FASCGraphData* GraphData = FindCacheFileGraphData(Graph);
+		if (FASCCommentData* CommentData = GraphData ? GraphData->CommentData.Find(Comment->NodeGuid) : nullptr)
 		{
-			UE_LOG(LogAutoSizeComments, Log, TEXT("Failed to load auto size comments cache: %s"), *GetCachePath(true));
+			TArray<uint8> Payload;
+			FMemoryWriter Ar(Payload);
+			ASCCacheJournal::BeginPayload(Ar, ASCCacheJournal::ERecordType::Comment, PackageName);
+
+			FGuid GraphGuid = Graph->GraphGuid;
+			Ar << GraphGuid;
+			ASCCacheBinaryFormat::WriteComment(Ar, Comment->NodeGuid, *CommentData);
+
+			AppendJournalRecord(Payload);
 		}
 	}
-	else if (FPlatformFileManager::Get().GetPlatformFile().FileExists(*OldCachePath))
+}
+
+void FAutoSizeCommentsCacheFile::MarkDirty(UEdGraph* Graph)
+{
+	if (!Graph || UAutoSizeCommentsSettings::Get().CacheSaveMethod != EASCCacheSaveMethod::File)
+	{
+		return;
+	}
+
+	const FName PackageName = Graph->GetOutermost()->GetFName();
+	DirtyPackages.Add(PackageName);
+
+	if (ShouldUseJournal())
+	{
+		// a removed graph is written without any comments
+		static const FASCGraphData EmptyGraphData;
+		const FASCGraphData* GraphData = FindCacheFileGraphData(Graph);
+		AppendGraphJournalRecord(PackageName, Graph->GraphGuid, GraphData ? *GraphData : EmptyGraphData);
+	}
+}
+
+void FAutoSizeCommentsCacheFile::AppendGraphJournalRecord(FName PackageName, const FGuid& GraphGuid, const FASCGraphData& GraphData)
+{
+	TArray<uint8> Payload;
+	FMemoryWriter Ar(Payload);
+	ASCCacheJournal::BeginPayload(Ar, ASCCacheJournal::ERecordType::Graph, PackageName);
+	ASCCacheBinaryFormat::WriteGraph(Ar, GraphGuid, GraphData);
+
+	AppendJournalRecord(Payload);
+}
+
+void FAutoSizeCommentsCacheFile::MarkPackageRemoved(FName PackageName)
+{
+	DirtyPackages.Add(PackageName);
+
+	if (ShouldUseJournal())
+	{
+		TArray<uint8> Payload;
+		FMemoryWriter Ar(Payload);
+		ASCCacheJournal::BeginPayload(Ar, ASCCacheJournal::ERecordType::RemovePackage, PackageName);
+
+		AppendJournalRecord(Payload);
+	}
+}
+
+bool FAutoSizeCommentsCacheFile::ShouldUseJournal() const
+{
+	const UAutoSizeCommentsSettings& Settings = UAutoSizeCommentsSettings::Get();
+	return Settings.bUseCacheJournal && Settings.CacheSaveMethod == EASCCacheSaveMethod::File && !GIsCookerLoadingPackage && !bJournalFailed;
+}
+
+void FAutoSizeCommentsCacheFile::AppendJournalRecord(const TArray<uint8>& Payload)
+{
+	if (!JournalHandle)
 	{
-		FFileHelper::LoadFileToString(FileData, *OldCachePath);
+		const FString JournalPath = GetJournalPath();
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		PlatformFile.CreateDirectoryTree(*FPaths::GetPath(JournalPath));
 
-		if (FJsonObjectConverter::JsonObjectStringToUStruct(FileData, &CacheData, 0, 0))
+		JournalHandle.Reset(PlatformFile.OpenWrite(*JournalPath, true));
+		if (!JournalHandle)
 		{
-			UE_LOG(LogAutoSizeComments, Log, TEXT("Loaded auto size comments cache from old cache path: %s"), *GetAlternateCachePath(true));
+			OnJournalFailed(TEXT("open"));
+			return;
 		}
-		else
+
+		if (JournalHandle->Size() == 0)
 		{
-			UE_LOG(LogAutoSizeComments, Log, TEXT("Failed to load auto size comments cache from old cache path: %s"), *GetAlternateCachePath(true));
+			TArray<uint8> Header;
+			ASCCacheJournal::WriteHeader(Header);
+			if (!JournalHandle->Write(Header.GetData(), Header.Num()))
+			{
+				OnJournalFailed(TEXT("write"));
+				return;
+			}
 		}
 	}
 
-	CleanupFiles();
+	TArray<uint8> Record;
+	ASCCacheJournal::WriteRecord(Payload, Record);
+	if (!JournalHandle->Write(Record.GetData(), Record.Num()))
+	{
+		OnJournalFailed(TEXT("write"));
+	}
+}
 
-	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
-	AssetRegistry.OnFilesLoaded().RemoveAll(this);
+void FAutoSizeCommentsCacheFile::OnJournalFailed(const TCHAR* Operation)
+{
+	// the changes are still in the dirty packages, so the cache is saved without the journal for the rest of the session
+	UE_LOG(LogAutoSizeComments, Warning, TEXT("Failed to %s cache journal %s, saving the cache files directly instead"), Operation, *FPaths::ConvertRelativePathToFull(GetJournalPath()));
+	JournalHandle.Reset();
+	bJournalFailed = true;
 }
 
-FASCCacheData FAutoSizeCommentsCacheFile::CreateCacheFromFile()
+void FAutoSizeCommentsCacheFile::ReplayJournals(FASCCacheData& Data, bool bTrackChanges)
 {
-	FASCCacheData NewCacheData;
+	const FString JournalPath = GetJournalPath();
 
-	const FString CachePath = GetCachePath();
-	const FString OldCachePath = GetAlternateCachePath();
+	TArray<FString> JournalFiles;
+	FindJournalFiles(JournalPath, JournalFiles);
 
-	FString FileData;
-	if (FPlatformFileManager::Get().GetPlatformFile().FileExists(*CachePath))
+	// the packages changed by the journal need their file loaded first and written on the next save
+	const auto OnPackageChanged = [this, bTrackChanges](FName PackageName)
 	{
-		FFileHelper::LoadFileToString(FileData, *CachePath);
+		if (bTrackChanges)
+		{
+			LoadPackageShard(PackageName);
+			DirtyPackages.Add(PackageName);
+		}
+	};
+
+	for (const FString& JournalFile : JournalFiles)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+
+		TArray<uint8> FileData;
+		if (!FFileHelper::LoadFileToArray(FileData, *JournalFile))
+		{
+			continue;
+		}
 
-		if (FJsonObjectConverter::JsonObjectStringToUStruct(FileData, &NewCacheData, 0, 0))
+		int64 EndOffset = 0;
+		const int32 NumRecords = ASCCacheJournal::Replay(FileData, Data, OnPackageChanged, EndOffset);
+		if (NumRecords == INDEX_NONE)
 		{
-			UE_LOG(LogAutoSizeComments, Log, TEXT("Loaded auto size comments cache: %s"), *GetCachePath(true));
+			UE_LOG(LogAutoSizeComments, Warning, TEXT("Failed to read cache journal %s"), *FPaths::ConvertRelativePathToFull(JournalFile));
 		}
 		else
 		{
-			UE_LOG(LogAutoSizeComments, Log, TEXT("Failed to load auto size comments cache: %s"), *GetCachePath(true));
+			const double TimeTaken = (FPlatformTime::Seconds() - StartTime) * 1000.0f;
+			UE_LOG(LogAutoSizeComments, Log, TEXT("Replayed %d records from cache journal %s took %6.2fms"), NumRecords, *FPaths::ConvertRelativePathToFull(JournalFile), TimeTaken);
 		}
-	}
-	else
-	{
-		FFileHelper::LoadFileToString(FileData, *OldCachePath);
 
-		if (FJsonObjectConverter::JsonObjectStringToUStruct(FileData, &NewCacheData, 0, 0))
+		if (!bTrackChanges)
 		{
-			UE_LOG(LogAutoSizeComments, Log, TEXT("Loaded auto size comments cache from old cache path: %s"), *GetAlternateCachePath(true));
+			continue;
 		}
-		else
+
+		// the journal is moved aside when saving, so only the older journals need deleting once saved
+		if (JournalFile != JournalPath)
+		{
+			ReplayedJournals.Add(JournalFile);
+			continue;
+		}
+
+		// records appended after a torn record (or to an unreadable journal) could never be replayed, so start a new journal
+		if (EndOffset < FileData.Num())
 		{
-			UE_LOG(LogAutoSizeComments, Log, TEXT("Failed to load auto size comments cache from old cache path: %s"), *GetAlternateCachePath(true));
+			UE_LOG(LogAutoSizeComments, Warning, TEXT("Cache journal %s ends in an incomplete record, starting a new journal"), *FPaths::ConvertRelativePathToFull(JournalFile));
+
+			FString MovedJournalPath;
+			if (ASCCacheJournal::MoveAside(JournalPath, MovedJournalPath))
+			{
+				ReplayedJournals.Add(MovedJournalPath);
+			}
+			else
+			{
+				OnJournalFailed(TEXT("move"));
+			}
 		}
 	}
+}
+
+int64 FAutoSizeCommentsCacheFile::GetJournalSize()
+{
+	if (JournalHandle)
+	{
+		return JournalHandle->Size();
+	}
 
-	return NewCacheData;
+	return FMath::Max<int64>(IFileManager::Get().FileSize(*GetJournalPath()), 0);
 }
 
-void FAutoSizeCommentsCacheFile::InitMetaData()
+FString FAutoSizeCommentsCacheFile::GetJournalPath(const FString& CachePath)
 {
-	
+	return FPaths::ChangeExtension(CachePath, TEXT("ascjournal"));
 }
 
-void FAutoSizeCommentsCacheFile::SaveCacheToFile()
+void FAutoSizeCommentsCacheFile::FindJournalFiles(const FString& JournalPath, TArray<FString>& OutPaths)
 {
-	if (UAutoSizeCommentsSettings::Get().CacheSaveMethod != EASCCacheSaveMethod::File)
-	{
-		return;
-	}
+	// journals moved aside are named by the time they were moved
+	const FString JournalDir = FPaths::GetPath(JournalPath);
+	TArray<FString> FileNames;
+	IFileManager::Get().FindFiles(FileNames, *(JournalDir / (FPaths::GetBaseFilename(JournalPath) + TEXT("_*.ascjournal"))), true, false);
+	FileNames.Sort();
 
-	// Don't save the cache while cooking 
-	if (GIsCookerLoadingPackage)
+	for (const FString& FileName : FileNames)
 	{
-		return;
+		OutPaths.Add(JournalDir / FileName);
 	}
 
-	for (UEdGraph* Graph : FAutoSizeCommentGraphHandler::Get().GetActiveGraphs())
+	if (FPlatformFileManager::Get().GetPlatformFile().FileExists(*JournalPath))
 	{
-		FASCGraphData& CacheGraphData = GetGraphData(Graph);
-		CacheGraphData.CleanupGraph(Graph);
+		OutPaths.Add(JournalPath);
 	}
-
-	const double StartTime = FPlatformTime::Seconds();
-
-	const auto CachePath = GetCachePath();
-
-	// Write data to file
-	FString JsonAsString;
-	FJsonObjectConverter::UStructToJsonObjectString(CacheData, JsonAsString, 0, 0, 0, nullptr, UAutoSizeCommentsSettings::Get().bPrettyPrintCommentCacheJSON);
-	FFileHelper::SaveStringToFile(JsonAsString, *CachePath);
-	const double TimeTaken = (FPlatformTime::Seconds() - StartTime) * 1000.0f;
-	UE_LOG(LogAutoSizeComments, Log, TEXT("Saved cache to %s took %6.2fms"), *GetCachePath(true), TimeTaken);
 }
 
-void FAutoSizeCommentsCacheFile::DeleteCache()
+bool FAutoSizeCommentsCacheFile::SerializeCacheData(const FASCCacheData& Data, EASCCacheFileFormat Format, TArray<uint8>& OutBytes, bool bPrettyPrintJson)
 {
-	const FString ProjectCachePath = GetProjectCachePath();
-	const FString PluginCachePath = GetPluginCachePath();
+	OutBytes.Reset();
 
-	CacheData.PackageData.Reset();
-
-	if (FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*ProjectCachePath))
+	if (Format == EASCCacheFileFormat::Binary)
 	{
-		UE_LOG(LogAutoSizeComments, Log, TEXT("Deleted project cache file at %s"), *GetCachePath(true));
+		ASCCacheBinaryFormat::Write(Data, OutBytes);
+		return true;
 	}
 
-	if (FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*PluginCachePath))
+	FString JsonAsString;
+	if (!FJsonObjectConverter::UStructToJsonObjectString(Data, JsonAsString, 0, 0, 0, nullptr, bPrettyPrintJson))
 	{
-		UE_LOG(LogAutoSizeComments, Log, TEXT("Deleted plugin cache file at %s"), *GetCachePath(true));
+		return false;
 	}
+
+	const FTCHARToUTF8 JsonAsUTF8(*JsonAsString);
+	OutBytes.Append(reinterpret_cast<const uint8*>(JsonAsUTF8.Get()), JsonAsUTF8.Length());
+	return true;
 }
 
-void FAutoSizeCommentsCacheFile::CleanupFiles()
+bool FAutoSizeCommentsCacheFile::WriteFileAtomic(const FString& Path, const TArray<uint8>& Bytes)
 {
-	if (UAutoSizeCommentsSettings::Get().bDisablePackageCleanup)
+	const FString TempPath = Path + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempPath))
 	{
-		return;
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return false;
 	}
 
-	// Get all assets
-	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
-	TArray<FAssetData> AllAssets;
-
-	// Get package guids from assets
-	TSet<FName> CurrentPackageNames;
-
-#if ASC_UE_VERSION_OR_LATER(5, 0)
-	TArray<FAssetData> Assets;
-	FARFilter Filter;
-	AssetRegistry.GetAllAssets(Assets, true);
-	for (FAssetData& Asset : Assets)
+	if (!IFileManager::Get().Move(*Path, *TempPath, true, true))
 	{
-		CurrentPackageNames.Add(Asset.PackageName);
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return false;
 	}
-#else
-	const auto& AssetDataMap = AssetRegistry.GetAssetRegistryState()->GetObjectPathToAssetDataMap();
-	for (const TPair<FName, const FAssetData*>& AssetDataPair : AssetDataMap)
+
+	return true;
+}
+
+bool FAutoSizeCommentsCacheFile::DeserializeCacheData(const TArray<uint8>& Bytes, EASCCacheFileFormat Format, FASCCacheData& OutData)
+{
+	if (Format == EASCCacheFileFormat::Binary)
 	{
-		const FAssetData* AssetData = AssetDataPair.Value;
-		CurrentPackageNames.Add(AssetData->PackageName);
+		return ASCCacheBinaryFormat::Read(Bytes, OutData);
 	}
-#endif
 
-	// Remove missing files
-	TArray<FName> OldPackageGuids;
-	CacheData.PackageData.GetKeys(OldPackageGuids);
-	for (FName PackageGuid : OldPackageGuids)
+	FString JsonAsString;
+	FFileHelper::BufferToString(JsonAsString, Bytes.GetData(), Bytes.Num());
+	return FJsonObjectConverter::JsonObjectStringToUStruct(JsonAsString, &OutData, 0, 0);
+}
+
+bool FAutoSizeCommentsCacheFile::LoadCacheData(FASCCacheData& OutData)
+{
+	const EASCCacheFileFormat Format = UAutoSizeCommentsSettings::Get().CacheFileFormat;
+	const EASCCacheFileFormat OtherFormat = Format == EASCCacheFileFormat::Binary ? EASCCacheFileFormat::Json : EASCCacheFileFormat::Binary;
+
+	// prefer the current location and format, otherwise migrate from the other format or the old location
+	const TPair<FString, EASCCacheFileFormat> CacheFiles[] = {
+		{ GetCachePath(), Format },
+		{ GetCachePathForFormat(GetCachePath(), OtherFormat), OtherFormat },
+		{ GetAlternateCachePath(), Format },
+		{ GetCachePathForFormat(GetAlternateCachePath(), OtherFormat), OtherFormat },
+	};
+
+	for (const TPair<FString, EASCCacheFileFormat>& CacheFile : CacheFiles)
 	{
-		if (!CurrentPackageNames.Contains(PackageGuid))
+		if (LoadCacheFile(CacheFile.Key, CacheFile.Value, OutData))
 		{
-			CacheData.PackageData.Remove(PackageGuid);
+			return true;
 		}
 	}
-}
 
-FASCCommentData& FAutoSizeCommentsCacheFile::GetCommentData(UEdGraphNode_Comment* Comment)
-{
-	return GetGraphData(Comment->GetGraph()).GetCommentData(Comment);
+	return false;
 }
 
-FASCGraphData& FAutoSizeCommentsCacheFile::GetGraphData(UEdGraph* Graph)
+bool FAutoSizeCommentsCacheFile::LoadCacheFile(const FString& CachePath, EASCCacheFileFormat Format, FASCCacheData& OutData, ELogVerbosity::Type Verbosity, bool bRecoverTempFile)
 {
-	check(Graph);
-
-	// load from cache file class
-	if (UAutoSizeCommentsSettings::Get().CacheSaveMethod == EASCCacheSaveMethod::File)
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.FileExists(*CachePath))
 	{
-		FASCGraphData& GraphData = GetCacheFileGraphData(Graph);
-		if (GraphData.bInitialized)
+		if (!bRecoverTempFile)
 		{
-			return GraphData;
+			return false;
 		}
 
-		GraphData.bInitialized = true;
-
-		// if we have no data, try loading from the package's meta data
-		if (GraphData.IsEmpty())
+		// a save interrupted after removing the old file leaves only the new file under the temp name
+		const FString TempPath = CachePath + TEXT(".tmp");
+		if (!PlatformFile.FileExists(*TempPath) || !PlatformFile.MoveFile(*CachePath, *TempPath))
 		{
-			GraphData.LoadFromPackageMetaData(Graph);
-			GraphData.bInitialized = true;
+			return false;
 		}
 
-		return GraphData;
+		UE_LOG(LogAutoSizeComments, Log, TEXT("Recovered cache file %s from an interrupted save"), *FPaths::ConvertRelativePathToFull(CachePath));
 	}
 
-	// load and store from package metadata
+	const double StartTime = FPlatformTime::Seconds();
+	const FString FormatName = StaticEnum<EASCCacheFileFormat>()->GetNameStringByValue(static_cast<int64>(Format));
+	const FString FullPath = FPaths::ConvertRelativePathToFull(CachePath);
+
+	TArray<uint8> FileData;
+	FASCCacheData LoadedData;
+	if (FFileHelper::LoadFileToArray(FileData, *CachePath) && DeserializeCacheData(FileData, Format, LoadedData))
 	{
-		FASCGraphHandlerData& GraphHandlerData = FAutoSizeCommentGraphHandler::Get().GetGraphHandlerData(Graph);
-		FASCGraphData& GraphData = GraphHandlerData.GraphCacheData;
-		if (GraphData.bInitialized)
+		OutData = MoveTemp(LoadedData);
+
+		const double TimeTaken = (FPlatformTime::Seconds() - StartTime) * 1000.0f;
+		if (Verbosity == ELogVerbosity::Verbose)
 		{
-			return GraphData;
+			UE_LOG(LogAutoSizeComments, Verbose, TEXT("Loaded auto size comments cache (%s, %d bytes): %s took %6.2fms"), *FormatName, FileData.Num(), *FullPath, TimeTaken);
 		}
-
-		if (GraphData.LoadFromPackageMetaData(Graph))
+		else
 		{
-			GraphData.bInitialized = true;
-			return GraphData;
+			UE_LOG(LogAutoSizeComments, Log, TEXT("Loaded auto size comments cache (%s, %d bytes): %s took %6.2fms"), *FormatName, FileData.Num(), *FullPath, TimeTaken);
 		}
 
-		// we failed to load from the package meta data, load from the cache file
-		GraphData = GetCacheFileGraphData(Graph);
-		GraphData.bInitialized = true;
-
-		// write any data we got from the cache file to the meta data
-		GraphData.SaveToPackageMetaData(Graph);
-
-		return GraphData;
+		return true;
 	}
-}
-
-bool FAutoSizeCommentsCacheFile::RemoveGraphData(UEdGraph* Graph)
-{
-	UPackage* Package = Graph->GetOutermost();
-	FASCPackageData& PackageData = CacheData.PackageData.FindOrAdd(Package->GetFName());
-	return PackageData.GraphData.Remove(Graph->GraphGuid) > 0;
-}
 
-FASCPackageData* FAutoSizeCommentsCacheFile::FindPackageData(UPackage* Package)
-{
-	return CacheData.PackageData.Find(Package->GetFName());
+	UE_LOG(LogAutoSizeComments, Log, TEXT("Failed to load auto size comments cache (%s): %s"), *FormatName, *FullPath);
+	return false;
 }
 
-void FAutoSizeCommentsCacheFile::ClearPackageMetaData(UEdGraph* Graph)
+FString FAutoSizeCommentsCacheFile::GetShardDirectory()
 {
-	if (UPackage* AssetPackage = Graph->GetPackage())
+	if (UAutoSizeCommentsSettings::Get().CacheSaveLocation == EASCCacheSaveLocation::Project)
 	{
-		if (FASCMetaData* MetaData = FASCUtils::GetPackageMetaData(AssetPackage))
-		{
-			MetaData->RemoveValue(Graph, NAME_ASC_GRAPH_DATA);
-		}
+		return FPaths::ProjectDir() / TEXT("Saved") / TEXT("AutoSizeComments") / TEXT("Packages");
 	}
+
+	const UGeneralProjectSettings* ProjectSettings = GetDefault<UGeneralProjectSettings>();
+	return IPluginManager::Get().FindPlugin("AutoSizeComments")->GetBaseDir() / TEXT("ASCCache") / ProjectSettings->ProjectID.ToString();
 }
 
-FString FAutoSizeCommentsCacheFile::GetProjectCachePath(bool bFullPath)
+FString FAutoSizeCommentsCacheFile::GetShardPath(FName PackageName, EASCCacheFileFormat Format)
 {
-	return FPaths::ProjectDir() / TEXT("Saved") / TEXT("AutoSizeComments") / TEXT("AutoSizeCommentsCache.json");
+	// readable short name, with a hash of the full (case insensitive) name so packages with the same short name don't collide
+	const FString LongName = PackageName.ToString();
+	// hash the utf8 bytes, TCHAR is a different size on each platform and the plugin cache folder can be shared
+	const FTCHARToUTF8 LowerName(*LongName.ToLower());
+	const uint64 NameHash = CityHash64(LowerName.Get(), LowerName.Length());
+	const FString FileName = FString::Printf(TEXT("%s_%016llx.json"), *FPackageName::GetShortName(LongName), NameHash);
+	return GetCachePathForFormat(GetShardDirectory() / FileName, Format);
 }
 
-FString FAutoSizeCommentsCacheFile::GetPluginCachePath(bool bFullPath)
+void FAutoSizeCommentsCacheFile::LoadPackageShard(FName PackageName)
 {
-	FString PluginDir = IPluginManager::Get().FindPlugin("AutoSizeComments")->GetBaseDir();
+	// the cache data was loaded from the single cache file, or the package files have been merged into it
+	if (!bCacheDataSplit)
+	{
+		return;
+	}
 
-	if (bFullPath)
+	bool bAlreadyLoaded = false;
+	LoadedShards.Add(PackageName, &bAlreadyLoaded);
+	if (bAlreadyLoaded)
 	{
-		PluginDir = FPaths::ConvertRelativePathToFull(PluginDir);
+		return;
 	}
 
-	const UGeneralProjectSettings* ProjectSettings = GetDefault<UGeneralProjectSettings>();
-	const FGuid& ProjectID = ProjectSettings->ProjectID;
+	// data migrated from the single cache file is newer than the package file
+	if (CacheData.PackageData.Contains(PackageName))
+	{
+		return;
+	}
+
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FAutoSizeCommentsCacheFile::LoadPackageShard"), STAT_ASC_LoadPackageShard, STATGROUP_AutoSizeComments);
+
+	const EASCCacheFileFormat Format = UAutoSizeCommentsSettings::Get().CacheFileFormat;
+	const EASCCacheFileFormat OtherFormat = Format == EASCCacheFileFormat::Binary ? EASCCacheFileFormat::Json : EASCCacheFileFormat::Binary;
+
+	FASCCacheData ShardData;
+	const bool bLoadedFormat = LoadCacheFile(GetShardPath(PackageName, Format), Format, ShardData, ELogVerbosity::Verbose);
+	const bool bLoadedOtherFormat = !bLoadedFormat && LoadCacheFile(GetShardPath(PackageName, OtherFormat), OtherFormat, ShardData, ELogVerbosity::Verbose);
+	if (bLoadedFormat || bLoadedOtherFormat)
+	{
+		// the file name is hashed, make sure it was written for this package
+		if (FASCPackageData* PackageData = ShardData.PackageData.Find(PackageName))
+		{
+			CacheData.PackageData.Add(PackageName, MoveTemp(*PackageData));
 
-	return PluginDir + "/ASCCache/" + ProjectID.ToString() + ".json";
+			// migrate the file to the current format on the next save
+			if (bLoadedOtherFormat)
+			{
+				DirtyPackages.Add(PackageName);
+			}
+		}
+	}
 }
 
-FString FAutoSizeCommentsCacheFile::GetCachePath(bool bFullPath)
+void FAutoSizeCommentsCacheFile::FindShardFiles(TArray<FString>& OutPaths)
 {
-	const bool bIsProject = UAutoSizeCommentsSettings::Get().CacheSaveLocation == EASCCacheSaveLocation::Project;
-	return bIsProject ? GetProjectCachePath(bFullPath) : GetPluginCachePath(bFullPath);
+	// skip the temp files left by an interrupted save, they are recovered when loading the package
+	const FString ShardDirectory = GetShardDirectory();
+	for (const TCHAR* Extension : { TEXT("json"), TEXT("ascbin") })
+	{
+		TArray<FString> FileNames;
+		IFileManager::Get().FindFiles(FileNames, *ShardDirectory, Extension);
+		for (const FString& FileName : FileNames)
+		{
+			OutPaths.Add(ShardDirectory / FileName);
+		}
+	}
 }
 
-FString FAutoSizeCommentsCacheFile::GetAlternateCachePath(bool bFullPath)
+void FAutoSizeCommentsCacheFile::LoadAllShards(FASCCacheData& OutData)
 {
-	const bool bIsProject = UAutoSizeCommentsSettings::Get().CacheSaveLocation == EASCCacheSaveLocation::Project;
-	return bIsProject ? GetPluginCachePath(bFullPath) : GetProjectCachePath(bFullPath);
+	TArray<FString> ShardFiles;
+	FindShardFiles(ShardFiles);
+
+	for (const FString& ShardFile : ShardFiles)
+	{
+		const EASCCacheFileFormat Format = FPaths::GetExtension(ShardFile) == TEXT("ascbin") ? EASCCacheFileFormat::Binary : EASCCacheFileFormat::Json;
+
+		FASCCacheData ShardData;
+		if (LoadCacheFile(ShardFile, Format, ShardData, ELogVerbosity::Verbose))
+		{
+			OutData.PackageData.Append(MoveTemp(ShardData.PackageData));
+		}
+	}
 }
 
 bool FAutoSizeCommentsCacheFile::GetNodesUnderComment(TSharedPtr<SAutoSizeCommentsGraphNode> ASCNode, TArray<UEdGraphNode*>& OutNodesUnderComment)
@@ -352,17 +1701,15 @@ bool FAutoSizeCommentsCacheFile::GetNodesUnderComment(TSharedPtr<SAutoSizeCommen
 	UEdGraphNode* Node = ASCNode->GetNodeObj();
 	UEdGraph* Graph = Node->GetGraph();
 	FASCGraphData& Data = GetGraphData(Graph);
-	if (Data.CommentData.Contains(Node->NodeGuid))
+	if (FASCCommentData* CommentData = Data.CommentData.Find(Node->NodeGuid))
 	{
-		for (FGuid NodeInsideGuid : Data.CommentData[Node->NodeGuid].NodeGuids)
+		FAutoSizeCommentGraphHandler& GraphHandler = FAutoSizeCommentGraphHandler::Get();
+		OutNodesUnderComment.Reserve(OutNodesUnderComment.Num() + CommentData->NodeGuids.Num());
+		for (const FGuid& NodeInsideGuid : CommentData->NodeGuids)
 		{
-			for (UEdGraphNode* NodeOnGraph : Graph->Nodes)
+			if (UEdGraphNode* NodeOnGraph = GraphHandler.FindNodeByGuid(Graph, NodeInsideGuid))
 			{
-				if (NodeOnGraph->NodeGuid == NodeInsideGuid)
-				{
-					OutNodesUnderComment.Add(NodeOnGraph);
-					break;
-				}
+				OutNodesUnderComment.Add(NodeOnGraph);
 			}
 		}
 
@@ -376,7 +1723,14 @@ FASCCommentData& FAutoSizeCommentsCacheFile::GetCommentData(UEdGraphNode* Commen
 {
 	UEdGraph* Graph = CommentNode->GetGraph();
 	FASCGraphData& Data = GetGraphData(Graph);
-	return Data.CommentData.FindOrAdd(CommentNode->NodeGuid);
+	if (FASCCommentData* CommentData = Data.CommentData.Find(CommentNode->NodeGuid))
+	{
+		return *CommentData;
+	}
+
+	FASCCommentData& CommentData = Data.CommentData.Add(CommentNode->NodeGuid);
+	MarkCommentDirty(CommentNode);
+	return CommentData;
 }
 
 void FAutoSizeCommentsCacheFile::PrintCache()
@@ -414,40 +1768,60 @@ void FAutoSizeCommentsCacheFile::OnObjectLoaded(UObject* Obj)
 FASCGraphData& FAutoSizeCommentsCacheFile::GetCacheFileGraphData(UEdGraph* Graph)
 {
 	UPackage* Package = Graph->GetOutermost();
+	LoadPackageShard(Package->GetFName());
 	FASCPackageData& PackageData = CacheData.PackageData.FindOrAdd(Package->GetFName());
 	FASCGraphData& GraphData = PackageData.GraphData.FindOrAdd(Graph->GraphGuid);
 	return GraphData;
 }
 
-void FAutoSizeCommentsCacheFile::OnPreExit()
+FASCGraphData* FAutoSizeCommentsCacheFile::FindCacheFileGraphData(UEdGraph* Graph)
 {
-	if (UAutoSizeCommentsSettings::Get().bSaveCommentDataOnExit)
+	if (FASCPackageData* PackageData = FindPackageData(Graph->GetOutermost()))
 	{
-		SaveCacheToFile();
+		return PackageData->GraphData.Find(Graph->GraphGuid);
 	}
+
+	return nullptr;
+}
+
+void FAutoSizeCommentsCacheFile::OnPreExit()
+{
+	SaveCacheToFile();
+
+	// the save must be written before exiting
+	FlushPendingSave();
 }
 
-void FASCCommentData::UpdateNodesUnderComment(UEdGraphNode_Comment* Comment)
+bool FASCCommentData::UpdateNodesUnderComment(UEdGraphNode_Comment* Comment)
 {
 	if (!Comment)
 	{
-		return;
+		return false;
 	}
 
 	const TArray<UEdGraphNode*> NodesUnder = FASCUtils::GetNodesUnderComment(Comment);
-	NodeGuids.Reset(NodesUnder.Num());
+	TArray<FGuid> NewNodeGuids;
+	NewNodeGuids.Reserve(NodesUnder.Num());
 
 	// update nodes under
 	for (UEdGraphNode* Node : NodesUnder)
 	{
 		if (!FASCUtils::HasNodeBeenDeleted(Node))
 		{
-			NodeGuids.Add(Node->NodeGuid);
+			NewNodeGuids.Add(Node->NodeGuid);
 		}
 	}
+
+	if (NewNodeGuids == NodeGuids)
+	{
+		return false;
+	}
+
+	NodeGuids = MoveTemp(NewNodeGuids);
+	return true;
 }
 
-void FASCGraphData::CleanupGraph(UEdGraph* Graph)
+bool FASCGraphData::CleanupGraph(UEdGraph* Graph)
 {
 	// Get all the current nodes from the graph
 	TSet<FGuid> CurrentNodes;
@@ -457,6 +1831,7 @@ void FASCGraphData::CleanupGraph(UEdGraph* Graph)
 	}
 
 	// Remove any missing guids from the cached comments nodes
+	bool bChanged = false;
 	TArray<FGuid> NodesToRemove;
 	for (auto& Elem : CommentData)
 	{
@@ -474,6 +1849,7 @@ void FASCGraphData::CleanupGraph(UEdGraph* Graph)
 			if (!CurrentNodes.Contains(Node))
 			{
 				ContainingNodes.RemoveAt(i);
+				bChanged = true;
 			}
 		}
 	}
@@ -482,6 +1858,8 @@ void FASCGraphData::CleanupGraph(UEdGraph* Graph)
 	{
 		CommentData.Remove(NodeGuid);
 	}
+
+	return bChanged || NodesToRemove.Num() > 0;
 }
 
 bool FASCGraphData::LoadFromPackageMetaData(UEdGraph* Graph)
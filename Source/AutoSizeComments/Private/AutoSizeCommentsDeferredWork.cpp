@@ -0,0 +1,77 @@
+// Copyright fpwong. All Rights Reserved.
+
+#include "AutoSizeCommentsDeferredWork.h"
+
+#include "AutoSizeCommentsGraphNode.h"
+#include "Editor.h"
+#include "TimerManager.h"
+#include "Misc/LazySingleton.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred Work Requested"), STAT_ASC_DeferredWorkRequested, STATGROUP_AutoSizeComments);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred Work Coalesced"), STAT_ASC_DeferredWorkCoalesced, STATGROUP_AutoSizeComments);
+
+FASCDeferredWork& FASCDeferredWork::Get()
+{
+	return TLazySingleton<FASCDeferredWork>::Get();
+}
+
+void FASCDeferredWork::TearDown()
+{
+	TLazySingleton<FASCDeferredWork>::TearDown();
+}
+
+void FASCDeferredWork::Request(EASCDeferredWork Kind, const void* Key, FSimpleDelegate Work)
+{
+	++NumRequested;
+	INC_DWORD_STAT(STAT_ASC_DeferredWorkRequested);
+
+	const TPair<uint8, const void*> PendingKey(static_cast<uint8>(Kind), Key);
+	if (const int32* PendingIndex = PendingKeys.Find(PendingKey))
+	{
+		++NumCoalesced;
+		INC_DWORD_STAT(STAT_ASC_DeferredWorkCoalesced);
+		PendingWork[*PendingIndex].Work = MoveTemp(Work);
+		return;
+	}
+
+	PendingKeys.Add(PendingKey, PendingWork.Num());
+
+	FPendingWork& NewWork = PendingWork.AddDefaulted_GetRef();
+	NewWork.Kind = Kind;
+	NewWork.Key = Key;
+	NewWork.Work = MoveTemp(Work);
+
+	if (!TimerHandle.IsValid() && GEditor)
+	{
+		TimerHandle = GEditor->GetTimerManager()->SetTimerForNextTick(FTimerDelegate::CreateRaw(this, &FASCDeferredWork::RunPendingWork));
+	}
+}
+
+void FASCDeferredWork::Cleanup()
+{
+	if (TimerHandle.IsValid() && GEditor)
+	{
+		GEditor->GetTimerManager()->ClearTimer(TimerHandle);
+	}
+
+	TimerHandle.Invalidate();
+	PendingWork.Empty();
+	PendingKeys.Empty();
+}
+
+void FASCDeferredWork::RunPendingWork()
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCDeferredWork::RunPendingWork"), STAT_ASC_RunPendingWork, STATGROUP_AutoSizeComments);
+
+	TimerHandle.Invalidate();
+
+	// anything requested while running goes into the next batch
+	TArray<FPendingWork> WorkToRun = MoveTemp(PendingWork);
+	PendingWork.Reset();
+	PendingKeys.Reset();
+
+	for (FPendingWork& Work : WorkToRun)
+	{
+		Work.Work.ExecuteIfBound();
+	}
+}
@@ -3,6 +3,7 @@
 #include "AutoSizeCommentsGraphHandler.h"
 
 #include "AutoSizeCommentsCacheFile.h"
+#include "AutoSizeCommentsDeferredWork.h"
 #include "AutoSizeCommentsGraphNode.h"
 #include "AutoSizeCommentsModule.h"
 #include "AutoSizeCommentsSettings.h"
@@ -28,6 +29,7 @@
 #include "Misc/TransactionObjectEvent.h"
 #endif
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Resize Queue Depth"), STAT_ASC_ResizeQueueDepth, STATGROUP_AutoSizeComments);
 
 struct FASCZoomLevel
 {
@@ -117,595 +119,1731 @@ struct FASCZoomLevelsContainer final : FZoomLevelsContainer
 };
 
 
-FAutoSizeCommentGraphHandler& FAutoSizeCommentGraphHandler::Get()
-{
-	return TLazySingleton<FAutoSizeCommentGraphHandler>::Get();
-}
-
-void FAutoSizeCommentGraphHandler::TearDown()
-{
-	TLazySingleton<FAutoSizeCommentGraphHandler>::TearDown();
-}
-
-void FAutoSizeCommentGraphHandler::BindDelegates()
-{
-	bPendingSave = false;
-#if ASC_UE_VERSION_OR_LATER(5, 0)
-	FCoreUObjectDelegates::OnObjectPreSave.AddRaw(this, &FAutoSizeCommentGraphHandler::OnObjectPreSave);
-	TickDelegateHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::Tick));
-#else
-	FCoreUObjectDelegates::OnObjectSaved.AddRaw(this, &FAutoSizeCommentGraphHandler::OnObjectSaved);
-	TickDelegateHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::Tick));
-#endif
-
-	FCoreUObjectDelegates::OnObjectTransacted.AddRaw(this, &FAutoSizeCommentGraphHandler::OnObjectTransacted);
-	FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FAutoSizeCommentGraphHandler::OnPostGarbageCollect);
-}
-
-void FAutoSizeCommentGraphHandler::UnbindDelegates()
+void FASCLiveNodeSet::Rebuild(UEdGraph* Graph)
 {
-#if ASC_UE_VERSION_OR_LATER(5, 0)
-	FCoreUObjectDelegates::OnObjectPreSave.RemoveAll(this);
-#else
-	FCoreUObjectDelegates::OnObjectSaved.RemoveAll(this);
-#endif
-	FCoreUObjectDelegates::OnObjectTransacted.RemoveAll(this);
-
-	FCoreUObjectDelegates::GetPostGarbageCollect().RemoveAll(this);
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCLiveNodeSet::Rebuild"), STAT_ASC_RebuildLiveNodes, STATGROUP_AutoSizeComments);
 
-	for (const auto& Kvp : GraphDatas)
+	TSet<FObjectKey> NewNodes;
+	NewNodes.Reserve(Graph->Nodes.Num());
+	NodesPendingGuid.Reset();
+	NodesByGuid.Reset();
+	NodesByGuid.Reserve(Graph->Nodes.Num());
+	for (UEdGraphNode* Node : Graph->Nodes)
 	{
-		if (Kvp.Key.IsValid())
+		if (Node)
 		{
-			Kvp.Key->RemoveOnGraphChangedHandler(Kvp.Value.OnGraphChangedHandle);
+			NewNodes.Add(FObjectKey(Node));
+			NodesByGuid.Add(Node->NodeGuid, Node);
 		}
 	}
 
-	GraphDatas.Empty();
-
-#if ASC_UE_VERSION_OR_LATER(5, 0)
-	FTSTicker::GetCoreTicker().RemoveTicker(TickDelegateHandle);
-#else
-	FTicker::GetCoreTicker().RemoveTicker(TickDelegateHandle);
-#endif
-}
-
-void FAutoSizeCommentGraphHandler::BindToGraph(UEdGraph* Graph)
-{
-	if (!Graph || GraphDatas.Contains(Graph))
+	// the periodic resync usually finds nothing changed, keep the generation so comments don't re-validate
+	if (NewNodes.Num() != Nodes.Num() || NewNodes.Difference(Nodes).Num() > 0)
 	{
-		return;
+		Nodes = MoveTemp(NewNodes);
+		++Generation;
 	}
 
-	// calling this Get function will initialize the graph (binding delegates)
-	GetGraphHandlerData(Graph);
-
-	CheckCacheDataError(Graph);
-}
-
-void FAutoSizeCommentGraphHandler::OnGraphChanged(const FEdGraphEditAction& Action)
-{
-	if ((Action.Action & GRAPHACTION_AddNode) != 0 && Action.bUserInvoked)
-	{
-		// only handle single node added 
-		if (Action.Nodes.Num() == 1)
-		{
-			UEdGraphNode* NewNode = const_cast<UEdGraphNode*>(Action.Nodes.Array()[0]);
-
-			// delay 1 tick as some nodes do not have their pins setup correctly on creation
-			GEditor->GetTimerManager()->SetTimerForNextTick(
-				FTimerDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::OnNodeAdded, TWeakObjectPtr<UEdGraphNode>(NewNode)));
-		}
-	}
-	else if ((Action.Action & GRAPHACTION_RemoveNode) != 0)
-	{
-		OnNodeDeleted(Action);
-	}
+	NumGraphNodes = Graph->Nodes.Num();
+	bStale = false;
 }
 
-void FAutoSizeCommentGraphHandler::AutoInsertIntoCommentNodes(TWeakObjectPtr<UEdGraphNode> NewNode, TWeakObjectPtr<UEdGraphNode> LastSelectedNode)
+void FASCLiveNodeSet::ApplyGraphAction(const FEdGraphEditAction& Action)
 {
-	EASCAutoInsertComment AutoInsertStyle = UAutoSizeCommentsSettings::Get().AutoInsertComment;
-	if (AutoInsertStyle == EASCAutoInsertComment::Never)
+	if (bStale)
 	{
 		return;
 	}
 
-	if (!NewNode.IsValid() || !IsValid(NewNode.Get()))
+	const bool bAdded = (Action.Action & GRAPHACTION_AddNode) != 0;
+	const bool bRemoved = (Action.Action & GRAPHACTION_RemoveNode) != 0;
+	if (!bAdded && !bRemoved)
 	{
 		return;
 	}
 
-	if (!LastSelectedNode.IsValid() || !IsValid(LastSelectedNode.Get()))
+	for (const UEdGraphNode* Node : Action.Nodes)
 	{
-		return;
-	}
-
-	UEdGraph* Graph = NewNode->GetGraph();
-	const auto IsSelectedNode = [&LastSelectedNode](UEdGraphNode* LinkedNode) { return LinkedNode == LastSelectedNode; };
-
-	TArray<UEdGraphNode*> LinkedInput = FASCUtils::GetLinkedNodes(NewNode.Get(), EGPD_Input);
-	TArray<UEdGraphNode*> LinkedOutput = FASCUtils::GetLinkedNodes(NewNode.Get(), EGPD_Output);
+		if (!Node)
+		{
+			continue;
+		}
 
-	UEdGraphNode** SelectedInput = LinkedInput.FindByPredicate(IsSelectedNode);
-	UEdGraphNode** SelectedOutput = LinkedOutput.FindByPredicate(IsSelectedNode);
+		if (bAdded)
+		{
+			bool bAlreadyInSet = false;
+			Nodes.Add(FObjectKey(Node), &bAlreadyInSet);
+			NumGraphNodes += bAlreadyInSet ? 0 : 1;
 
-	struct FLocal
-	{
-		static void TakeCommentNode(UEdGraph* Graph, UEdGraphNode* Node, UEdGraphNode* NodeToTakeFrom)
+			// spawning a node notifies the graph before creating its guid, so it is only added to the guid map on the next lookup
+			NodesPendingGuid.Add(const_cast<UEdGraphNode*>(Node));
+		}
+		else
 		{
-			if (!Graph || !Node || !NodeToTakeFrom)
-				return;
+			NumGraphNodes -= Nodes.Remove(FObjectKey(Node));
 
-			TArray<UEdGraphNode_Comment*> CommentNodes;
-			Graph->GetNodesOfClass(CommentNodes);
-			auto ContainingComments = FASCUtils::GetContainingCommentNodes(CommentNodes, NodeToTakeFrom);
-			for (UEdGraphNode_Comment* CommentNode : ContainingComments)
+			// another node may have been added with the same guid
+			const TWeakObjectPtr<UEdGraphNode>* GuidNode = NodesByGuid.Find(Node->NodeGuid);
+			if (GuidNode && GuidNode->Get() == Node)
 			{
-				FASCUtils::AddNodeIntoComment(CommentNode, Node);
+				NodesByGuid.Remove(Node->NodeGuid);
 			}
-		};
-	};
-
-	// always include parameter nodes (no exec pins)
-	const auto IsExecPin = [](const UEdGraphPin* Pin){ return Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec; };
-	if (!NewNode->Pins.ContainsByPredicate(IsExecPin))
-	{
-		AutoInsertStyle = EASCAutoInsertComment::Always;
+		}
 	}
 
-	if (AutoInsertStyle == EASCAutoInsertComment::Surrounded)
+	++Generation;
+}
+
+UEdGraphNode* FASCLiveNodeSet::FindNodeByGuid(UEdGraph* Graph, const FGuid& NodeGuid)
+{
+	for (const TWeakObjectPtr<UEdGraphNode>& PendingNode : NodesPendingGuid)
 	{
-		UEdGraphNode* NodeA = nullptr;
-		UEdGraphNode* NodeB = nullptr;
-		if (SelectedInput)
-		{
-			NodeA = *SelectedInput;
-			NodeB = LinkedOutput.Num() > 0 ? LinkedOutput[0] : nullptr;
-		}
-		else if (SelectedOutput)
+		if (UEdGraphNode* Node = PendingNode.Get())
 		{
-			NodeA = *SelectedOutput;
-			NodeB = LinkedInput.Num() > 0 ? LinkedInput[0] : nullptr;
+			if (Nodes.Contains(FObjectKey(Node)))
+			{
+				NodesByGuid.Add(Node->NodeGuid, Node);
+			}
 		}
+	}
 
-		if (NodeA == nullptr || NodeB == nullptr)
-		{
-			return;
-		}
+	NodesPendingGuid.Reset();
 
-		TArray<UEdGraphNode_Comment*> CommentNodes;
-		Graph->GetNodesOfClass(CommentNodes);
-		auto ContainingCommentsA = FASCUtils::GetContainingCommentNodes(CommentNodes, NodeA);
-		auto ContainingCommentsB = FASCUtils::GetContainingCommentNodes(CommentNodes, NodeB);
+	const TWeakObjectPtr<UEdGraphNode>* Found = NodesByGuid.Find(NodeGuid);
+	UEdGraphNode* Node = Found ? Found->Get() : nullptr;
 
-		ContainingCommentsA.RemoveAll([&ContainingCommentsB](UEdGraphNode_Comment* Comment)
-		{
-			return !ContainingCommentsB.Contains(Comment);
-		});
+	// the guid of a node can be changed after it was added to the graph (or collide with another node), so a miss or an
+	// out of date entry may come from the map rather than the graph. Rebuild on an out of date entry, or once per generation on a miss.
+	const bool bOutOfDate = Node && Node->NodeGuid != NodeGuid;
+	if (bOutOfDate || (!Node && GuidMissGeneration != Generation))
+	{
+		Rebuild(Graph);
+		GuidMissGeneration = Generation;
 
-		if (ContainingCommentsA.Num() > 0)
-		{
-			FLocal::TakeCommentNode(Graph, NewNode.Get(), NodeA);
-		}
+		Found = NodesByGuid.Find(NodeGuid);
+		Node = Found ? Found->Get() : nullptr;
 	}
-	else if (AutoInsertStyle == EASCAutoInsertComment::Always)
+
+	return Node;
+}
+
+void FASCContainmentIndex::Rebuild(UEdGraph* Graph)
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCContainmentIndex::Rebuild"), STAT_ASC_RebuildContainmentIndex, STATGROUP_AutoSizeComments);
+
+	NodeToComments.Reset();
+	for (UEdGraphNode* Node : Graph->Nodes)
 	{
-		if (SelectedInput)
-		{
-			FLocal::TakeCommentNode(Graph, NewNode.Get(), *SelectedInput);
-		}
-		else if (SelectedOutput)
+		if (UEdGraphNode_Comment* Comment = Cast<UEdGraphNode_Comment>(Node))
 		{
-			FLocal::TakeCommentNode(Graph, NewNode.Get(), *SelectedOutput);
+			AddComment(Comment);
 		}
 	}
+
+	bStale = false;
 }
 
-void FAutoSizeCommentGraphHandler::RegisterActiveGraphPanel(TSharedPtr<SGraphPanel> GraphPanel)
+void FASCContainmentIndex::AddComment(UEdGraphNode_Comment* Comment)
 {
-	if (GraphPanel.IsValid() && !ActiveGraphPanels.Contains(GraphPanel))
+	for (UObject* Obj : Comment->GetNodesUnderComment())
 	{
-		if (UAutoSizeCommentsSettings::Get().bUseMaxDetailNodes)
+		if (Obj)
 		{
-			// TODO: Find fallback for <5.0 if possible
-#if ASC_UE_VERSION_OR_LATER(5, 0)
-			// init the graph panel
-			GraphPanel->SetZoomLevelsContainer<FASCZoomLevelsContainer>();
-#endif
+			NodeToComments.AddUnique(FObjectKey(Obj), Comment);
 		}
-
-		ActiveGraphPanels.Add(GraphPanel);
 	}
 }
 
-void FAutoSizeCommentGraphHandler::RequestGraphVisualRefresh(TSharedPtr<SGraphPanel> GraphPanel)
+void FASCContainmentIndex::RemoveComment(UEdGraphNode_Comment* Comment)
 {
-	if (bPendingGraphVisualRequest)
+	for (UObject* Obj : Comment->GetNodesUnderComment())
 	{
-		return;
+		if (Obj)
+		{
+			NodeToComments.Remove(FObjectKey(Obj), Comment);
+		}
 	}
-
-	bPendingGraphVisualRequest = true;
-
-	const auto Delegate = FTimerDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::RefreshGraphVisualRefresh, TWeakPtr<SGraphPanel>(GraphPanel));
-	GEditor->GetTimerManager()->SetTimerForNextTick(Delegate);
 }
 
-void FAutoSizeCommentGraphHandler::RefreshGraphVisualRefresh(TWeakPtr<SGraphPanel> GraphPanel)
+void FASCContainmentIndex::ApplyGraphAction(const FEdGraphEditAction& Action)
 {
-	bPendingGraphVisualRequest = false;
-
-	if (!GraphPanel.IsValid())
+	if (bStale)
 	{
 		return;
 	}
 
-	GraphPanel.Pin()->PurgeVisualRepresentation();
+	const bool bAdded = (Action.Action & GRAPHACTION_AddNode) != 0;
+	const bool bRemoved = (Action.Action & GRAPHACTION_RemoveNode) != 0;
+	if (!bAdded && !bRemoved)
+	{
+		return;
+	}
 
-	const auto UpdateGraphPanel = [](TWeakPtr<SGraphPanel> LocalPanel)
+	for (const UEdGraphNode* Node : Action.Nodes)
 	{
-		if (LocalPanel.IsValid())
+		if (UEdGraphNode_Comment* Comment = const_cast<UEdGraphNode_Comment*>(Cast<UEdGraphNode_Comment>(Node)))
 		{
-			LocalPanel.Pin()->Update();
+			if (bAdded)
+			{
+				AddComment(Comment);
+			}
+			else
+			{
+				RemoveComment(Comment);
+			}
 		}
-	};
-
-	GEditor->GetTimerManager()->SetTimerForNextTick(FTimerDelegate::CreateLambda(UpdateGraphPanel, GraphPanel));
+	}
 }
 
-EASCResizingMode FAutoSizeCommentGraphHandler::GetResizingMode(UEdGraph* Graph) const
+void FASCCommentReachability::Rebuild(UEdGraph* Graph)
 {
-	const UAutoSizeCommentsSettings& ASCSettings = UAutoSizeCommentsSettings::Get();
+	CommentIndices.Reset();
+	Comments.Reset();
+	for (UEdGraphNode* Node : Graph->Nodes)
+	{
+		if (UEdGraphNode_Comment* Comment = Cast<UEdGraphNode_Comment>(Node))
+		{
+			CommentIndices.Add(FObjectKey(Comment), Comments.Add(Comment));
+		}
+	}
 
-	if (Graph)
+	DirectParents.Reset();
+	DirectParents.SetNum(Comments.Num());
+	for (int32 Row = 0; Row < Comments.Num(); ++Row)
 	{
-		if (UClass* Class = Graph->GetClass())
+		for (UObject* Obj : Comments[Row]->GetNodesUnderComment())
 		{
-			if (const FASCGraphSettings* GraphSettings = ASCSettings.GraphSettingsOverride.Find(Class->GetFName()))
+			const int32* ChildIndex = Obj ? CommentIndices.Find(FObjectKey(Obj)) : nullptr;
+			if (ChildIndex && *ChildIndex != Row)
 			{
-				return GraphSettings->ResizingMode;
+				DirectParents[*ChildIndex].AddUnique(Row);
 			}
 		}
 	}
 
-	return ASCSettings.ResizingMode;
+	// rows are calculated on demand
+	Descendants.Reset();
+	Descendants.SetNum(Comments.Num());
+	DirtyRows.Init(true, Comments.Num());
+
+	bStale = false;
 }
 
-void FAutoSizeCommentGraphHandler::CheckCacheDataError(UEdGraph* Graph)
+void FASCCommentReachability::OnNestingAdded(UEdGraphNode_Comment* Parent, UEdGraphNode_Comment* Child)
 {
-	FASCGraphData& GraphData = FAutoSizeCommentsCacheFile::Get().GetGraphData(Graph);
-	TArray<UEdGraphNode_Comment*> Comments = FASCUtils::GetCommentsFromGraph(Graph);
-
-	// skip if we have no comment data for this graph
-	if (GraphData.CommentData.Num() == 0)
+	if (bStale)
 	{
 		return;
 	}
 
-	TSet<FGuid> OldGuids;
-	GraphData.CommentData.GetKeys(OldGuids);
+	const int32* ParentIndex = CommentIndices.Find(FObjectKey(Parent));
+	const int32* ChildIndex = CommentIndices.Find(FObjectKey(Child));
+	if (!ParentIndex || !ChildIndex)
+	{
+		bStale = true;
+		return;
+	}
 
-	TSet<FGuid> CurrentGuids;
-	for (UEdGraphNode_Comment* Comment : Comments)
+	if (*ChildIndex != *ParentIndex)
 	{
-		CurrentGuids.Add(Comment->NodeGuid);
+		DirectParents[*ChildIndex].AddUnique(*ParentIndex);
 	}
 
-	const int MissingGuids = OldGuids.Difference(CurrentGuids).Num();
+	if (DirtyRows[*ChildIndex])
+	{
+		UpdateRow(*ChildIndex);
+	}
 
-	// this is to check if the nodes are having their guid's refreshed somehow
-	// so if we have the same number of nodes and they are all wrong, print an error msg
-	if (OldGuids.Num() == CurrentGuids.Num() && MissingGuids == OldGuids.Num())
+	TArray<int32> AddedRows;
+	AddedRows.Add(*ChildIndex);
+	for (TConstSetBitIterator<> It(Descendants[*ChildIndex]); It; ++It)
 	{
-		UE_LOG(LogAutoSizeComments, Error, TEXT(
-			"Graph '%s' has failed to load all comments\n"
-			"Please report issue this at: https://github.com/AutoSizeComments/AutoSizeComments/issues/13\n"
-			"Please describe any special details of your project (for example: did you just upgrade your project to a new engine version?"),
-			*Graph->GetName());
+		AddedRows.Add(It.GetIndex());
+	}
 
-		FNotificationInfo Info(INVTEXT("ASC: Graph has failed to load comments, see output log for more details"));
-		Info.ExpireDuration = 5.0f;
-		FSlateNotificationManager::Get().AddNotification(Info);
+	// the child and everything under it is now nested under the parent and its ancestors
+	TArray<int32> Rows;
+	GetSelfAndAncestors(*ParentIndex, Rows);
+	for (int32 Row : Rows)
+	{
+		if (DirtyRows[Row])
+		{
+			continue;
+		}
 
-		GraphData.CommentData.Empty();
+		for (int32 AddedRow : AddedRows)
+		{
+			Descendants[Row][AddedRow] = true;
+		}
 	}
 }
 
-EGraphRenderingLOD::Type FAutoSizeCommentGraphHandler::GetGraphLOD(TSharedPtr<SGraphPanel> GraphPanel)
+void FASCCommentReachability::OnNestingRemoved(UEdGraphNode_Comment* Parent, UEdGraphNode_Comment* Child)
 {
-	if (!GraphPanel.IsValid())
+	if (bStale)
 	{
-		return EGraphRenderingLOD::Type::DefaultDetail;
+		return;
 	}
 
-	// if we use MaxDetailNodes, we are setting the LOD to DefaultDetail all the time
-	// we need to calculate the LOD without the setting on to fix things such as comment bubbles
-	if (!UAutoSizeCommentsSettings::Get().bUseMaxDetailNodes)
+	const int32* ParentIndex = CommentIndices.Find(FObjectKey(Parent));
+	if (!ParentIndex)
 	{
-		return GraphPanel->GetCurrentLOD();
+		bStale = true;
+		return;
 	}
 
-	UEdGraph* Graph = GraphPanel->GetGraphObj();
-	if (!Graph)
+	if (const int32* ChildIndex = CommentIndices.Find(FObjectKey(Child)))
 	{
-		return EGraphRenderingLOD::Type::DefaultDetail;
+		DirectParents[*ChildIndex].Remove(*ParentIndex);
 	}
 
-	FASCGraphHandlerData& Data = GetGraphHandlerData(Graph);
+	// the child may still be reachable through another path, so recalculate the parent and its ancestors
+	TArray<int32> Rows;
+	GetSelfAndAncestors(*ParentIndex, Rows);
+	for (int32 Row : Rows)
+	{
+		DirtyRows[Row] = true;
+	}
+}
 
-	const float ZoomAmount = GraphPanel->GetZoomAmount();
+void FASCCommentReachability::GetSelfAndAncestors(int32 Row, TArray<int32>& OutRows) const
+{
+	TBitArray<> Visited(false, Comments.Num());
+	Visited[Row] = true;
+	OutRows.Add(Row);
 
-	if (ZoomAmount != Data.LastZoomLevel)
+	for (int32 Index = 0; Index < OutRows.Num(); ++Index)
 	{
-		Data.LastZoomLevel = ZoomAmount;
-
-		if (ZoomAmount <= 0.200f)
+		for (int32 ParentRow : DirectParents[OutRows[Index]])
+		{
+			if (!Visited[ParentRow])
+			{
+				Visited[ParentRow] = true;
+				OutRows.Add(ParentRow);
+			}
+		}
+	}
+}
+
+bool FASCCommentReachability::TryGetContains(UEdGraphNode_Comment* Source, UEdGraphNode_Comment* Other, bool& bOutContains)
+{
+	const int32* SourceIndex = CommentIndices.Find(FObjectKey(Source));
+	const int32* OtherIndex = CommentIndices.Find(FObjectKey(Other));
+	if (!SourceIndex || !OtherIndex)
+	{
+		return false;
+	}
+
+	if (DirtyRows[*SourceIndex])
+	{
+		UpdateRow(*SourceIndex);
+	}
+
+	bOutContains = Descendants[*SourceIndex][*OtherIndex];
+	return true;
+}
+
+void FASCCommentReachability::UpdateRow(int32 Row)
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCCommentReachability::UpdateRow"), STAT_ASC_ReachabilityUpdateRow, STATGROUP_AutoSizeComments);
+
+	TBitArray<>& RowBits = Descendants[Row];
+	RowBits.Init(false, Comments.Num());
+
+	TArray<int32> Stack;
+	Stack.Add(Row);
+	while (Stack.Num() > 0)
+	{
+		UEdGraphNode_Comment* Comment = Comments[Stack.Pop(false)].Get();
+		if (!Comment)
+		{
+			continue;
+		}
+
+		for (UObject* Obj : Comment->GetNodesUnderComment())
+		{
+			const int32* ChildIndex = Obj ? CommentIndices.Find(FObjectKey(Obj)) : nullptr;
+			if (ChildIndex && !RowBits[*ChildIndex])
+			{
+				RowBits[*ChildIndex] = true;
+				Stack.Add(*ChildIndex);
+			}
+		}
+	}
+
+	DirtyRows[Row] = false;
+}
+
+void FASCNodeHighlight::SetRelatedNodes(UEdGraph* Graph, const TSet<UEdGraphNode*>& NewRelatedNodes)
+{
+#if ASC_UE_VERSION_OR_LATER(4, 23)
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCNodeHighlight::SetRelatedNodes"), STAT_ASC_SetRelatedNodes, STATGROUP_AutoSizeComments);
+
+	if (!bActive)
+	{
+		// every node starts as related, so the whole graph needs to be written once
+		for (UEdGraphNode* Node : Graph->Nodes)
+		{
+			if (Node)
+			{
+				Node->SetNodeUnrelated(!NewRelatedNodes.Contains(Node));
+			}
+		}
+	}
+	else
+	{
+		for (const TWeakObjectPtr<UEdGraphNode>& OldNode : RelatedNodes)
+		{
+			if (UEdGraphNode* Node = OldNode.Get())
+			{
+				if (!NewRelatedNodes.Contains(Node))
+				{
+					Node->SetNodeUnrelated(true);
+				}
+			}
+		}
+
+		for (UEdGraphNode* Node : NewRelatedNodes)
+		{
+			if (Node && !RelatedNodes.Contains(Node))
+			{
+				Node->SetNodeUnrelated(false);
+			}
+		}
+	}
+
+	RelatedNodes.Reset();
+	for (UEdGraphNode* Node : NewRelatedNodes)
+	{
+		RelatedNodes.Add(Node);
+	}
+
+	bActive = true;
+#endif
+}
+
+void FASCNodeHighlight::SetNodeRelated(UEdGraphNode* Node, bool bRelated)
+{
+#if ASC_UE_VERSION_OR_LATER(4, 23)
+	if (!bActive || !Node)
+	{
+		return;
+	}
+
+	Node->SetNodeUnrelated(!bRelated);
+	if (bRelated)
+	{
+		RelatedNodes.Add(Node);
+	}
+	else
+	{
+		RelatedNodes.Remove(Node);
+	}
+#endif
+}
+
+void FASCNodeHighlight::Reset(UEdGraph* Graph)
+{
+#if ASC_UE_VERSION_OR_LATER(4, 23)
+	if (!bActive)
+	{
+		return;
+	}
+
+	for (UEdGraphNode* Node : Graph->Nodes)
+	{
+		if (Node)
+		{
+			Node->SetNodeUnrelated(false);
+		}
+	}
+
+	RelatedNodes.Reset();
+	bActive = false;
+#endif
+}
+
+FAutoSizeCommentGraphHandler& FAutoSizeCommentGraphHandler::Get()
+{
+	return TLazySingleton<FAutoSizeCommentGraphHandler>::Get();
+}
+
+void FAutoSizeCommentGraphHandler::TearDown()
+{
+	TLazySingleton<FAutoSizeCommentGraphHandler>::TearDown();
+}
+
+void FAutoSizeCommentGraphHandler::BindDelegates()
+{
+#if ASC_UE_VERSION_OR_LATER(5, 0)
+	FCoreUObjectDelegates::OnObjectPreSave.AddRaw(this, &FAutoSizeCommentGraphHandler::OnObjectPreSave);
+	TickDelegateHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::Tick));
+#else
+	FCoreUObjectDelegates::OnObjectSaved.AddRaw(this, &FAutoSizeCommentGraphHandler::OnObjectSaved);
+	TickDelegateHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::Tick));
+#endif
+
+	FCoreUObjectDelegates::OnObjectTransacted.AddRaw(this, &FAutoSizeCommentGraphHandler::OnObjectTransacted);
+	FCoreUObjectDelegates::OnObjectPropertyChanged.AddRaw(this, &FAutoSizeCommentGraphHandler::OnObjectPropertyChanged);
+	FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FAutoSizeCommentGraphHandler::OnPostGarbageCollect);
+
+	if (GEditor)
+	{
+		GEditor->OnBlueprintCompiled().AddRaw(this, &FAutoSizeCommentGraphHandler::OnBlueprintCompiled);
+	}
+}
+
+void FAutoSizeCommentGraphHandler::UnbindDelegates()
+{
+#if ASC_UE_VERSION_OR_LATER(5, 0)
+	FCoreUObjectDelegates::OnObjectPreSave.RemoveAll(this);
+#else
+	FCoreUObjectDelegates::OnObjectSaved.RemoveAll(this);
+#endif
+	FCoreUObjectDelegates::OnObjectTransacted.RemoveAll(this);
+	FCoreUObjectDelegates::OnObjectPropertyChanged.RemoveAll(this);
+
+	FCoreUObjectDelegates::GetPostGarbageCollect().RemoveAll(this);
+
+	if (GEditor)
+	{
+		GEditor->OnBlueprintCompiled().RemoveAll(this);
+	}
+
+	for (const auto& Kvp : GraphDatas)
+	{
+		if (Kvp.Key.IsValid())
+		{
+			Kvp.Key->RemoveOnGraphChangedHandler(Kvp.Value.OnGraphChangedHandle);
+		}
+	}
+
+	GraphDatas.Empty();
+
+#if ASC_UE_VERSION_OR_LATER(5, 0)
+	FTSTicker::GetCoreTicker().RemoveTicker(TickDelegateHandle);
+#else
+	FTicker::GetCoreTicker().RemoveTicker(TickDelegateHandle);
+#endif
+}
+
+void FAutoSizeCommentGraphHandler::BindToGraph(UEdGraph* Graph)
+{
+	if (!Graph || GraphDatas.Contains(Graph))
+	{
+		return;
+	}
+
+	// calling this Get function will initialize the graph (binding delegates)
+	GetGraphHandlerData(Graph);
+
+	CheckCacheDataError(Graph);
+}
+
+void FAutoSizeCommentGraphHandler::OnGraphChanged(const FEdGraphEditAction& Action)
+{
+	if (FASCGraphHandlerData* GraphData = GraphDatas.Find(Action.Graph))
+	{
+		GraphData->SpatialIndex.MarkDirty();
+		GraphData->LiveNodes.ApplyGraphAction(Action);
+		GraphData->ContainmentIndex.ApplyGraphAction(Action);
+
+		// adding or removing a comment changes the comment indices
+		if ((Action.Action & (GRAPHACTION_AddNode | GRAPHACTION_RemoveNode)) != 0 &&
+			Action.Nodes.Array().ContainsByPredicate([](const UEdGraphNode* Node) { return Cast<UEdGraphNode_Comment>(Node) != nullptr; }))
+		{
+			GraphData->CommentReachability.bStale = true;
+		}
+
+		// only the related nodes are written while highlighting, so dim new nodes here
+		if ((Action.Action & GRAPHACTION_AddNode) != 0 && GraphData->Highlight.bActive)
+		{
+			for (const UEdGraphNode* Node : Action.Nodes)
+			{
+				GraphData->Highlight.SetNodeRelated(const_cast<UEdGraphNode*>(Node), false);
+			}
+		}
+	}
+
+	// only the comments containing removed nodes need to check for changes, a new node is not in any comment
+	// until it is added to one (see OnNodeAddedToComment) so only new comments need to check themselves
+	if ((Action.Action & GRAPHACTION_RemoveNode) != 0)
+	{
+		for (const UEdGraphNode* Node : Action.Nodes)
+		{
+			MarkContainingCommentsDirty(const_cast<UEdGraphNode*>(Node));
+		}
+	}
+	else if ((Action.Action & GRAPHACTION_AddNode) != 0)
+	{
+		for (const UEdGraphNode* Node : Action.Nodes)
+		{
+			if (UEdGraphNode_Comment* Comment = const_cast<UEdGraphNode_Comment*>(Cast<UEdGraphNode_Comment>(Node)))
+			{
+				MarkCommentDirty(Comment);
+			}
+		}
+	}
+	else if ((Action.Action & GRAPHACTION_SelectNode) != 0)
+	{
+		MarkSelectionDirty();
+	}
+	else
+	{
+		// a generic graph change (e.g. pasting) may also have assigned new node guids or changed the nesting
+		if (FASCGraphHandlerData* GraphData = GraphDatas.Find(Action.Graph))
+		{
+			GraphData->LiveNodes.bStale = true;
+			GraphData->ContainmentIndex.bStale = true;
+			GraphData->CommentReachability.bStale = true;
+		}
+
+		MarkGraphDirty(Action.Graph);
+	}
+
+	if ((Action.Action & GRAPHACTION_AddNode) != 0 && Action.bUserInvoked)
+	{
+		// only handle single node added 
+		if (Action.Nodes.Num() == 1)
+		{
+			UEdGraphNode* NewNode = const_cast<UEdGraphNode*>(Action.Nodes.Array()[0]);
+
+			// delay 1 tick as some nodes do not have their pins setup correctly on creation
+			FASCDeferredWork::Get().Request(EASCDeferredWork::NodeAdded, NewNode,
+				FSimpleDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::OnNodeAdded, TWeakObjectPtr<UEdGraphNode>(NewNode)));
+		}
+	}
+	else if ((Action.Action & GRAPHACTION_RemoveNode) != 0)
+	{
+		FAutoSizeCommentsCacheFile::Get().MarkNeedsCleanup(Action.Graph);
+		OnNodeDeleted(Action);
+	}
+}
+
+void FAutoSizeCommentGraphHandler::AutoInsertIntoCommentNodes(TWeakObjectPtr<UEdGraphNode> NewNode, TWeakObjectPtr<UEdGraphNode> LastSelectedNode)
+{
+	EASCAutoInsertComment AutoInsertStyle = UAutoSizeCommentsSettings::Get().AutoInsertComment;
+	if (AutoInsertStyle == EASCAutoInsertComment::Never)
+	{
+		return;
+	}
+
+	if (!NewNode.IsValid() || !IsValid(NewNode.Get()))
+	{
+		return;
+	}
+
+	if (!LastSelectedNode.IsValid() || !IsValid(LastSelectedNode.Get()))
+	{
+		return;
+	}
+
+	UEdGraph* Graph = NewNode->GetGraph();
+	const auto IsSelectedNode = [&LastSelectedNode](UEdGraphNode* LinkedNode) { return LinkedNode == LastSelectedNode; };
+
+	TArray<UEdGraphNode*> LinkedInput = FASCUtils::GetLinkedNodes(NewNode.Get(), EGPD_Input);
+	TArray<UEdGraphNode*> LinkedOutput = FASCUtils::GetLinkedNodes(NewNode.Get(), EGPD_Output);
+
+	UEdGraphNode** SelectedInput = LinkedInput.FindByPredicate(IsSelectedNode);
+	UEdGraphNode** SelectedOutput = LinkedOutput.FindByPredicate(IsSelectedNode);
+
+	struct FLocal
+	{
+		static void TakeCommentNode(UEdGraph* Graph, UEdGraphNode* Node, UEdGraphNode* NodeToTakeFrom)
+		{
+			if (!Graph || !Node || !NodeToTakeFrom)
+				return;
+
+			auto ContainingComments = FAutoSizeCommentGraphHandler::Get().GetContainingComments(NodeToTakeFrom);
+			for (UEdGraphNode_Comment* CommentNode : ContainingComments)
+			{
+				FASCUtils::AddNodeIntoComment(CommentNode, Node);
+			}
+		};
+	};
+
+	// always include parameter nodes (no exec pins)
+	const auto IsExecPin = [](const UEdGraphPin* Pin){ return Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec; };
+	if (!NewNode->Pins.ContainsByPredicate(IsExecPin))
+	{
+		AutoInsertStyle = EASCAutoInsertComment::Always;
+	}
+
+	if (AutoInsertStyle == EASCAutoInsertComment::Surrounded)
+	{
+		UEdGraphNode* NodeA = nullptr;
+		UEdGraphNode* NodeB = nullptr;
+		if (SelectedInput)
+		{
+			NodeA = *SelectedInput;
+			NodeB = LinkedOutput.Num() > 0 ? LinkedOutput[0] : nullptr;
+		}
+		else if (SelectedOutput)
+		{
+			NodeA = *SelectedOutput;
+			NodeB = LinkedInput.Num() > 0 ? LinkedInput[0] : nullptr;
+		}
+
+		if (NodeA == nullptr || NodeB == nullptr)
+		{
+			return;
+		}
+
+		auto ContainingCommentsA = GetContainingComments(NodeA);
+		auto ContainingCommentsB = GetContainingComments(NodeB);
+
+		ContainingCommentsA.RemoveAll([&ContainingCommentsB](UEdGraphNode_Comment* Comment)
+		{
+			return !ContainingCommentsB.Contains(Comment);
+		});
+
+		if (ContainingCommentsA.Num() > 0)
+		{
+			FLocal::TakeCommentNode(Graph, NewNode.Get(), NodeA);
+		}
+	}
+	else if (AutoInsertStyle == EASCAutoInsertComment::Always)
+	{
+		if (SelectedInput)
+		{
+			FLocal::TakeCommentNode(Graph, NewNode.Get(), *SelectedInput);
+		}
+		else if (SelectedOutput)
+		{
+			FLocal::TakeCommentNode(Graph, NewNode.Get(), *SelectedOutput);
+		}
+	}
+}
+
+void FAutoSizeCommentGraphHandler::RegisterActiveGraphPanel(TSharedPtr<SGraphPanel> GraphPanel)
+{
+	if (GraphPanel.IsValid() && !ActiveGraphPanels.Contains(GraphPanel))
+	{
+		if (UAutoSizeCommentsSettings::Get().bUseMaxDetailNodes)
+		{
+			// TODO: Find fallback for <5.0 if possible
+#if ASC_UE_VERSION_OR_LATER(5, 0)
+			// init the graph panel
+			GraphPanel->SetZoomLevelsContainer<FASCZoomLevelsContainer>();
+#endif
+		}
+
+		ActiveGraphPanels.Add(GraphPanel);
+		MarkSelectionDirty();
+	}
+}
+
+void FAutoSizeCommentGraphHandler::RequestGraphVisualRefresh(TSharedPtr<SGraphPanel> GraphPanel)
+{
+	const auto Delegate = FSimpleDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::RefreshGraphVisualRefresh, TWeakPtr<SGraphPanel>(GraphPanel));
+	FASCDeferredWork::Get().Request(EASCDeferredWork::GraphVisualRefresh, GraphPanel.Get(), Delegate);
+}
+
+void FAutoSizeCommentGraphHandler::RefreshGraphVisualRefresh(TWeakPtr<SGraphPanel> GraphPanel)
+{
+	if (!GraphPanel.IsValid())
+	{
+		return;
+	}
+
+	GraphPanel.Pin()->PurgeVisualRepresentation();
+
+	const auto UpdateGraphPanel = [](TWeakPtr<SGraphPanel> LocalPanel)
+	{
+		if (LocalPanel.IsValid())
+		{
+			LocalPanel.Pin()->Update();
+		}
+	};
+
+	FASCDeferredWork::Get().Request(EASCDeferredWork::GraphPanelUpdate, GraphPanel.Pin().Get(), FSimpleDelegate::CreateLambda(UpdateGraphPanel, GraphPanel));
+}
+
+EASCResizingMode FAutoSizeCommentGraphHandler::GetResizingMode(UEdGraph* Graph) const
+{
+	const UAutoSizeCommentsSettings& ASCSettings = UAutoSizeCommentsSettings::Get();
+
+	if (Graph)
+	{
+		if (UClass* Class = Graph->GetClass())
+		{
+			if (const FASCGraphSettings* GraphSettings = ASCSettings.GraphSettingsOverride.Find(Class->GetFName()))
+			{
+				return GraphSettings->ResizingMode;
+			}
+		}
+	}
+
+	return ASCSettings.ResizingMode;
+}
+
+void FAutoSizeCommentGraphHandler::CheckCacheDataError(UEdGraph* Graph)
+{
+	FASCGraphData& GraphData = FAutoSizeCommentsCacheFile::Get().GetGraphData(Graph);
+	TArray<UEdGraphNode_Comment*> Comments = FASCUtils::GetCommentsFromGraph(Graph);
+
+	// skip if we have no comment data for this graph
+	if (GraphData.CommentData.Num() == 0)
+	{
+		return;
+	}
+
+	TSet<FGuid> OldGuids;
+	GraphData.CommentData.GetKeys(OldGuids);
+
+	TSet<FGuid> CurrentGuids;
+	for (UEdGraphNode_Comment* Comment : Comments)
+	{
+		CurrentGuids.Add(Comment->NodeGuid);
+	}
+
+	const int MissingGuids = OldGuids.Difference(CurrentGuids).Num();
+
+	// this is to check if the nodes are having their guid's refreshed somehow
+	// so if we have the same number of nodes and they are all wrong, print an error msg
+	if (OldGuids.Num() == CurrentGuids.Num() && MissingGuids == OldGuids.Num())
+	{
+		UE_LOG(LogAutoSizeComments, Error, TEXT(
+			"Graph '%s' has failed to load all comments\n"
+			"Please report issue this at: https://github.com/AutoSizeComments/AutoSizeComments/issues/13\n"
+			"Please describe any special details of your project (for example: did you just upgrade your project to a new engine version?"),
+			*Graph->GetName());
+
+		FNotificationInfo Info(INVTEXT("ASC: Graph has failed to load comments, see output log for more details"));
+		Info.ExpireDuration = 5.0f;
+		FSlateNotificationManager::Get().AddNotification(Info);
+
+		GraphData.CommentData.Empty();
+		FAutoSizeCommentsCacheFile::Get().MarkDirty(Graph);
+	}
+}
+
+EGraphRenderingLOD::Type FAutoSizeCommentGraphHandler::GetGraphLOD(TSharedPtr<SGraphPanel> GraphPanel)
+{
+	if (!GraphPanel.IsValid())
+	{
+		return EGraphRenderingLOD::Type::DefaultDetail;
+	}
+
+	// if we use MaxDetailNodes, we are setting the LOD to DefaultDetail all the time
+	// we need to calculate the LOD without the setting on to fix things such as comment bubbles
+	if (!UAutoSizeCommentsSettings::Get().bUseMaxDetailNodes)
+	{
+		return GraphPanel->GetCurrentLOD();
+	}
+
+	UEdGraph* Graph = GraphPanel->GetGraphObj();
+	if (!Graph)
+	{
+		return EGraphRenderingLOD::Type::DefaultDetail;
+	}
+
+	FASCGraphHandlerData& Data = GetGraphHandlerData(Graph);
+
+	const float ZoomAmount = GraphPanel->GetZoomAmount();
+
+	if (ZoomAmount != Data.LastZoomLevel)
+	{
+		Data.LastZoomLevel = ZoomAmount;
+
+		if (ZoomAmount <= 0.200f)
 		{
 			Data.LastLOD = EGraphRenderingLOD::LowestDetail;
 		}
-		else if (ZoomAmount <= 0.250f)
+		else if (ZoomAmount <= 0.250f)
+		{
+			Data.LastLOD = EGraphRenderingLOD::LowDetail;
+		}
+		else if (ZoomAmount <= 0.675f)
+		{
+			Data.LastLOD = EGraphRenderingLOD::MediumDetail;
+		}
+		else if (ZoomAmount <= 1.375f)
+		{
+			Data.LastLOD = EGraphRenderingLOD::DefaultDetail;
+		}
+		else
+		{
+			Data.LastLOD = EGraphRenderingLOD::FullyZoomedIn;
+		}
+	}
+
+	return Data.LastLOD;
+}
+
+void FAutoSizeCommentGraphHandler::ProcessAltReleased(TSharedPtr<SGraphPanel> GraphPanel)
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FAutoSizeCommentGraphHandler::ProcessAltReleased"), STAT_ASC_ProcessAltReleased, STATGROUP_AutoSizeComments);
+
+	if (!GraphPanel)
+	{
+		return;
+	}
+
+	auto Graph = GraphPanel->GetGraphObj();
+	if (!Graph)
+	{
+		return;
+	}
+
+	if (bProcessedAltReleased)
+	{
+		return;
+	}
+
+	bProcessedAltReleased = true;
+
+	TArray<UEdGraphNode_Comment*> CommentNodes;
+	Graph->GetNodesOfClass(CommentNodes);
+
+	TSet<UObject*> SelectedNodes;
+	for (auto Node : GraphPanel->SelectionManager.GetSelectedNodes())
+	{
+		SelectedNodes.Add(Node);
+		if (UEdGraphNode_Comment* SelectedComment = Cast<UEdGraphNode_Comment>(Node))
+		{
+			SelectedNodes.Append(SelectedComment->GetNodesUnderComment());
+		}
+	}
+
+	TMap<TSharedPtr<SAutoSizeCommentsGraphNode>, const TArray<UObject*>> OldCommentContains;
+	TMap<UEdGraphNode_Comment*, TArray<UEdGraphNode_Comment*>> OldParentMap;
+
+	TArray<TSharedPtr<SAutoSizeCommentsGraphNode>> ASCGraphNodes;
+	TSet<TSharedPtr<SAutoSizeCommentsGraphNode>> ChangedGraphNodes; 
+
+	// gather asc graph nodes and store the comment data for later
+	for (UEdGraphNode_Comment* CommentNode : CommentNodes)
+	{
+		TSharedPtr<SAutoSizeCommentsGraphNode> ASCGraphNode = FASCState::Get().GetASCComment(CommentNode);
+		if (!ASCGraphNode)
+		{
+			continue;
+		}
+
+		if (ASCGraphNode->IsHeaderComment())
+		{
+			continue;
+		}
+
+		ASCGraphNodes.Add(ASCGraphNode);
+
+		OldCommentContains.Add(ASCGraphNode, CommentNode->GetNodesUnderComment());
+
+		for (UObject* ContainedObj : CommentNode->GetNodesUnderComment())
+		{
+			if (UEdGraphNode_Comment* ContainedComment = Cast<UEdGraphNode_Comment>(ContainedObj))
+			{
+				OldParentMap.FindOrAdd(ContainedComment).Add(CommentNode);
+			}
+		}
+	}
+
+	const ECommentCollisionMethod& AltCollisionMethod = UAutoSizeCommentsSettings::Get().AltCollisionMethod;
+
+	// find the nodes under every unselected comment in a single sweep over the graph
+	TArray<FSlateRect> SweepCommentRects;
+	for (TSharedPtr<SAutoSizeCommentsGraphNode> ASCGraphNode : ASCGraphNodes)
+	{
+		if (!SelectedNodes.Contains(ASCGraphNode->GetCommentNodeObj()))
+		{
+			SweepCommentRects.Add(ASCGraphNode->GetCommentCollisionRect());
+		}
+	}
+
+	TArray<TSet<UEdGraphNode*>> SweepResults;
+	GetSpatialIndex(GraphPanel).SweepCollisions(SweepCommentRects, AltCollisionMethod, SweepResults);
+	int32 SweepIndex = 0;
+
+	// update their containing nodes
+	for (TSharedPtr<SAutoSizeCommentsGraphNode> ASCGraphNode : ASCGraphNodes)
+	{
+		UEdGraphNode_Comment* CommentNode = ASCGraphNode->GetCommentNodeObj();
+
+		if (SelectedNodes.Contains(CommentNode))
+		{
+			ASCGraphNode->RefreshNodesInsideComment(AltCollisionMethod, UAutoSizeCommentsSettings::Get().bIgnoreKnotNodesWhenPressingAlt, false);
+			ChangedGraphNodes.Add(ASCGraphNode);
+		}
+		else
+		{
+			// the sweep results are in the same order as the unselected comments
+			const TSet<UEdGraphNode*>& OutNodes = SweepResults[SweepIndex++];
+
+			TSet<UObject*> NewSelection(CommentNode->GetNodesUnderComment());
+			bool bChanged = false;
+			for (UObject* Node : SelectedNodes)
+			{
+				UEdGraphNode* SelectedGraphNode = Cast<UEdGraphNode>(Node);
+				if (SelectedGraphNode && SelectedGraphNode != CommentNode && OutNodes.Contains(SelectedGraphNode) && SAutoSizeCommentsGraphNode::IsMajorNode(SelectedGraphNode))
+				{
+					bool bAlreadyInSet = false;
+					NewSelection.Add(Node, &bAlreadyInSet);
+					bChanged |= !bAlreadyInSet;
+				}
+				else
+				{
+					if (NewSelection.Remove(Node) > 0)
+					{
+						bChanged = true;
+					}
+				}
+			}
+
+			if (bChanged)
+			{
+				FASCCommentNodesEdit Edit(CommentNode);
+				Edit.Clear();
+				for (UObject* Node : NewSelection)
+				{
+					if (ASCGraphNode->CanAddNode(Node))
+					{
+						Edit.Add(Node);
+					}
+				}
+
+				Edit.Commit(false);
+				ChangedGraphNodes.Add(ASCGraphNode);
+
+				if (UAutoSizeCommentsSettings::Get().ResizingMode != EASCResizingMode::Disabled)
+				{
+					ASCGraphNode->ResizeToFit();
+				}
+
+				ASCGraphNode->UpdateCache();
+			}
+		}
+	}
+
+	// update existing comment nodes using the parent comments stored earlier 
+	for (TSharedPtr<SAutoSizeCommentsGraphNode> GraphNode : ChangedGraphNodes)
+	{
+		const TArray<UEdGraphNode_Comment*>* OldParents = OldParentMap.Find(GraphNode->GetCommentNodeObj());
+		const TArray<UObject*>* OldContains = OldCommentContains.Find(GraphNode);
+		const FASCNestingChanges NestingChanges = GraphNode->UpdateExistingCommentNodes(OldParents, OldContains);
+
+		// only the comments which gained or lost a child need to check their size
+		for (UEdGraphNode_Comment* ChangedParent : NestingChanges.GetChangedParents())
+		{
+			MarkCommentDirty(ChangedParent);
+		}
+	}
+
+	FASCDeferredWork::Get().Request(EASCDeferredWork::ResetAltReleased, this, FSimpleDelegate::CreateLambda([this]
+	{
+		bProcessedAltReleased = false;
+	}));
+}
+
+FASCGraphHandlerData& FAutoSizeCommentGraphHandler::GetGraphHandlerData(UEdGraph* Graph)
+{
+	if (!GraphDatas.Contains(Graph))
+	{
+		FASCGraphHandlerData GraphData;
+
+		// read comments that already exist in the graph
+		for (auto Node : Graph->Nodes)
+		{
+			if (auto Comment = Cast<UEdGraphNode_Comment>(Node))
+			{
+				GraphData.InitialComments.Add(Comment);
+			}
+		}
+
+		GraphData.OnGraphChangedHandle = Graph->AddOnGraphChangedHandler(FOnGraphChanged::FDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::OnGraphChanged));
+		GraphDatas.Add(Graph, GraphData);
+	}
+
+	return GraphDatas[Graph]; 
+}
+
+void FAutoSizeCommentGraphHandler::UpdateCommentChangeState(UEdGraphNode_Comment* Comment)
+{
+	UEdGraph* Graph = Comment->GetGraph();
+	if (!Graph)
+	{
+		return;
+	}
+
+	FASCGraphHandlerData& GraphData = GetGraphHandlerData(Graph);
+	GraphData.CommentChangeData.FindOrAdd(Comment->NodeGuid).UpdateComment(Comment, GraphData.NodeChangeCache);
+}
+
+bool FAutoSizeCommentGraphHandler::HasCommentChangeState(UEdGraphNode_Comment* Comment) const
+{
+	if (UEdGraph* Graph = Comment->GetGraph())
+	{
+		if (const FASCGraphHandlerData* GraphData = GraphDatas.Find(Graph))
+		{
+			return GraphData->CommentChangeData.Contains(Comment->NodeGuid);
+		}
+	}
+
+	return false;
+}
+
+bool FAutoSizeCommentGraphHandler::HasCommentChanged(UEdGraphNode_Comment* Comment)
+{
+	if (FASCGraphHandlerData* GraphData = GraphDatas.Find(Comment->GetGraph()))
+	{
+		if (FASCCommentChangeData* CommentChangeData = GraphData->CommentChangeData.Find(Comment->NodeGuid))
+		{
+			return CommentChangeData->HasCommentChanged(Comment, GraphData->NodeChangeCache);
+		}
+	}
+
+	return false;
+}
+
+void FAutoSizeCommentGraphHandler::MarkCommentDirty(UEdGraphNode_Comment* Comment)
+{
+	if (!Comment)
+	{
+		return;
+	}
+
+	if (FASCGraphHandlerData* GraphData = GraphDatas.Find(Comment->GetGraph()))
+	{
+		GraphData->DirtyComments.Add(Comment->NodeGuid);
+
+		// we were not told which node changed, so check all of them
+		if (FASCCommentChangeData* CommentChangeData = GraphData->CommentChangeData.Find(Comment->NodeGuid))
 		{
-			Data.LastLOD = EGraphRenderingLOD::LowDetail;
+			CommentChangeData->InvalidateNodes(GraphData->NodeChangeCache);
 		}
-		else if (ZoomAmount <= 0.675f)
+	}
+}
+
+void FAutoSizeCommentGraphHandler::MarkContainingCommentsDirty(UEdGraphNode* Node)
+{
+	if (!Node)
+	{
+		return;
+	}
+
+	UEdGraph* Graph = Node->GetGraph();
+	FASCGraphHandlerData* GraphData = GraphDatas.Find(Graph);
+	if (!GraphData)
+	{
+		return;
+	}
+
+	GraphData->NodeChangeCache.Invalidate(Node);
+	GraphData->SpatialIndex.MarkNodeMoved(Node);
+
+	if (UEdGraphNode_Comment* Comment = Cast<UEdGraphNode_Comment>(Node))
+	{
+		GraphData->DirtyComments.Add(Comment->NodeGuid);
+	}
+
+	for (UEdGraphNode_Comment* Comment : GetContainingComments(Node))
+	{
+		GraphData->DirtyComments.Add(Comment->NodeGuid);
+	}
+}
+
+void FAutoSizeCommentGraphHandler::MarkGraphDirty(UEdGraph* Graph)
+{
+	if (FASCGraphHandlerData* GraphData = GraphDatas.Find(Graph))
+	{
+		++GraphData->DirtyGeneration;
+		GraphData->NodeChangeCache.InvalidateAll();
+		GraphData->SpatialIndex.MarkDirty();
+	}
+}
+
+bool FAutoSizeCommentGraphHandler::ConsumeCommentDirty(UEdGraphNode_Comment* Comment, uint32& InOutDirtyGeneration)
+{
+	UEdGraph* Graph = Comment ? Comment->GetGraph() : nullptr;
+	if (!Graph)
+	{
+		return false;
+	}
+
+	FASCGraphHandlerData& GraphData = GetGraphHandlerData(Graph);
+
+	bool bIsDirty = GraphData.DirtyComments.Remove(Comment->NodeGuid) > 0;
+	if (InOutDirtyGeneration != GraphData.DirtyGeneration)
+	{
+		InOutDirtyGeneration = GraphData.DirtyGeneration;
+		bIsDirty = true;
+	}
+
+	return bIsDirty;
+}
+
+bool FAutoSizeCommentGraphHandler::IsNodeOnGraph(UEdGraphNode* Node)
+{
+	if (Node == nullptr)
+	{
+		return false;
+	}
+
+	UEdGraph* Graph = Node->GetGraph();
+	if (!Graph)
+	{
+		return false;
+	}
+
+	// only graphs we are handling keep a live node set
+	if (FASCLiveNodeSet* LiveNodes = FindLiveNodes(Graph))
+	{
+		return LiveNodes->Nodes.Contains(FObjectKey(Node));
+	}
+
+	return Graph->Nodes.Contains(Node);
+}
+
+uint32 FAutoSizeCommentGraphHandler::GetLiveNodeGeneration(UEdGraph* Graph)
+{
+	FASCLiveNodeSet* LiveNodes = FindLiveNodes(Graph);
+	return LiveNodes ? LiveNodes->Generation : 0;
+}
+
+UEdGraphNode* FAutoSizeCommentGraphHandler::FindNodeByGuid(UEdGraph* Graph, const FGuid& NodeGuid)
+{
+	if (!Graph)
+	{
+		return nullptr;
+	}
+
+	if (FASCLiveNodeSet* LiveNodes = FindLiveNodes(Graph))
+	{
+		return LiveNodes->FindNodeByGuid(Graph, NodeGuid);
+	}
+
+	for (UEdGraphNode* Node : Graph->Nodes)
+	{
+		if (Node && Node->NodeGuid == NodeGuid)
 		{
-			Data.LastLOD = EGraphRenderingLOD::MediumDetail;
+			return Node;
 		}
-		else if (ZoomAmount <= 1.375f)
+	}
+
+	return nullptr;
+}
+
+TArray<UEdGraphNode_Comment*> FAutoSizeCommentGraphHandler::GetContainingComments(UEdGraphNode* Node)
+{
+	UEdGraph* Graph = Node ? Node->GetGraph() : nullptr;
+	if (!Graph)
+	{
+		return TArray<UEdGraphNode_Comment*>();
+	}
+
+	FASCContainmentIndex* ContainmentIndex = FindContainmentIndex(Graph);
+	if (!ContainmentIndex)
+	{
+		return FASCUtils::GetContainingCommentNodes(FASCUtils::GetCommentsFromGraph(Graph), Node);
+	}
+
+	TArray<TWeakObjectPtr<UEdGraphNode_Comment>> WeakComments;
+	ContainmentIndex->NodeToComments.MultiFind(FObjectKey(Node), WeakComments);
+
+	TArray<UEdGraphNode_Comment*> Comments;
+	Comments.Reserve(WeakComments.Num());
+	for (const TWeakObjectPtr<UEdGraphNode_Comment>& Comment : WeakComments)
+	{
+		if (Comment.IsValid() && Comment.Get() != Node)
 		{
-			Data.LastLOD = EGraphRenderingLOD::DefaultDetail;
+			Comments.Add(Comment.Get());
 		}
-		else
+	}
+
+	return Comments;
+}
+
+void FAutoSizeCommentGraphHandler::OnNodeAddedToComment(UEdGraphNode_Comment* Comment, UObject* Node)
+{
+	if (FASCGraphHandlerData* GraphData = GraphDatas.Find(Comment->GetGraph()))
+	{
+		if (!GraphData->ContainmentIndex.bStale)
 		{
-			Data.LastLOD = EGraphRenderingLOD::FullyZoomedIn;
+			GraphData->ContainmentIndex.NodeToComments.AddUnique(FObjectKey(Node), Comment);
+		}
+
+		GraphData->DirtyComments.Add(Comment->NodeGuid);
+
+		if (UEdGraphNode_Comment* ChildComment = Cast<UEdGraphNode_Comment>(Node))
+		{
+			GraphData->CommentReachability.OnNestingAdded(Comment, ChildComment);
 		}
 	}
+}
 
-	return Data.LastLOD;
+void FAutoSizeCommentGraphHandler::OnNodeRemovedFromComment(UEdGraphNode_Comment* Comment, UObject* Node)
+{
+	if (FASCGraphHandlerData* GraphData = GraphDatas.Find(Comment->GetGraph()))
+	{
+		if (!GraphData->ContainmentIndex.bStale)
+		{
+			GraphData->ContainmentIndex.NodeToComments.Remove(FObjectKey(Node), Comment);
+		}
+
+		GraphData->DirtyComments.Add(Comment->NodeGuid);
+
+		if (UEdGraphNode_Comment* ChildComment = Cast<UEdGraphNode_Comment>(Node))
+		{
+			GraphData->CommentReachability.OnNestingRemoved(Comment, ChildComment);
+		}
+	}
 }
 
-void FAutoSizeCommentGraphHandler::ProcessAltReleased(TSharedPtr<SGraphPanel> GraphPanel)
+bool FAutoSizeCommentGraphHandler::TryGetCommentContainsComment(UEdGraphNode_Comment* Source, UEdGraphNode_Comment* Other, bool& bOutContains)
 {
-	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FAutoSizeCommentGraphHandler::ProcessAltReleased"), STAT_ASC_ProcessAltReleased, STATGROUP_AutoSizeComments);
+	UEdGraph* Graph = Source->GetGraph();
+	if (!Graph || Graph != Other->GetGraph())
+	{
+		return false;
+	}
 
-	if (!GraphPanel)
+	FASCGraphHandlerData* GraphData = GraphDatas.Find(Graph);
+	if (!GraphData)
+	{
+		return false;
+	}
+
+	FASCCommentReachability& Reachability = GraphData->CommentReachability;
+	if (Reachability.bStale)
+	{
+		Reachability.Rebuild(Graph);
+	}
+
+	return Reachability.TryGetContains(Source, Other, bOutContains);
+}
+
+FASCContainmentIndex* FAutoSizeCommentGraphHandler::FindContainmentIndex(UEdGraph* Graph)
+{
+	FASCGraphHandlerData* GraphData = GraphDatas.Find(Graph);
+	if (!GraphData)
+	{
+		return nullptr;
+	}
+
+	if (GraphData->ContainmentIndex.bStale)
+	{
+		GraphData->ContainmentIndex.Rebuild(Graph);
+	}
+
+	return &GraphData->ContainmentIndex;
+}
+
+FASCLiveNodeSet* FAutoSizeCommentGraphHandler::FindLiveNodes(UEdGraph* Graph)
+{
+	FASCGraphHandlerData* GraphData = GraphDatas.Find(Graph);
+	if (!GraphData)
+	{
+		return nullptr;
+	}
+
+	FASCLiveNodeSet& LiveNodes = GraphData->LiveNodes;
+	if (LiveNodes.bStale || LiveNodes.NumGraphNodes != Graph->Nodes.Num())
+	{
+		const uint32 OldGeneration = LiveNodes.Generation;
+		LiveNodes.Rebuild(Graph);
+
+		// nodes changed without a notification, so the indices kept in sync from the notifications may be out of date too
+		if (LiveNodes.Generation != OldGeneration)
+		{
+			GraphData->ContainmentIndex.bStale = true;
+			GraphData->CommentReachability.bStale = true;
+		}
+	}
+
+	return &LiveNodes;
+}
+
+FASCNodeSpatialIndex& FAutoSizeCommentGraphHandler::GetSpatialIndex(TSharedPtr<SGraphPanel> GraphPanel)
+{
+	check(GraphPanel);
+
+	FASCNodeSpatialIndex& SpatialIndex = GetGraphHandlerData(GraphPanel->GetGraphObj()).SpatialIndex;
+	SpatialIndex.Refresh(GraphPanel);
+	return SpatialIndex;
+}
+
+TArray<UEdGraph*> FAutoSizeCommentGraphHandler::GetActiveGraphs()
+{
+	TArray<TWeakObjectPtr<UEdGraph>> GraphWeakPtrs;
+	GraphDatas.GetKeys(GraphWeakPtrs);
+
+	TArray<UEdGraph*> ActiveGraphs;
+
+	for (TWeakObjectPtr<UEdGraph> GraphWeakPtr : GraphWeakPtrs)
+	{
+		if (GraphWeakPtr.IsValid())
+		{
+			ActiveGraphs.Add(GraphWeakPtr.Get());
+		}
+	}
+
+	return ActiveGraphs;
+}
+
+TArray<TSharedPtr<SGraphPanel>> FAutoSizeCommentGraphHandler::GetActiveGraphPanels()
+{
+	TArray<TSharedPtr<SGraphPanel>> OutGraphPanels;
+	for (TWeakPtr<SGraphPanel> ActiveGraphPanel : ActiveGraphPanels)
+	{
+		if (ActiveGraphPanel.IsValid())
+		{
+			OutGraphPanels.Add(ActiveGraphPanel.Pin());
+		}
+	}
+
+	return OutGraphPanels;
+}
+
+bool FAutoSizeCommentGraphHandler::Tick(float DeltaTime)
+{
+	UpdateNodeUnrelatedState();
+
+	MarkDraggedNodesDirty();
+
+	ProcessResizeQueue();
+
+	ResizePendingComments();
+
+	// not every change to a node has a notification, so slowly cycle through the comments as a fallback
+	if (UAutoSizeCommentsSettings::Get().ChangePollInterval > 0)
+	{
+		for (auto& Elem : GraphDatas)
+		{
+			if (UEdGraph* Graph = Elem.Key.Get())
+			{
+				PollCommentsForChanges(Graph, Elem.Value, DeltaTime);
+			}
+		}
+	}
+
+	return true;
+}
+
+void FAutoSizeCommentGraphHandler::QueueResizeWork(TSharedPtr<SAutoSizeCommentsGraphNode> Comment, EASCResizeWork Work)
+{
+	if (!Comment)
 	{
 		return;
 	}
 
-	auto Graph = GraphPanel->GetGraphObj();
-	if (!Graph)
+	const TPair<const SAutoSizeCommentsGraphNode*, uint8> QueuedKey(Comment.Get(), static_cast<uint8>(Work));
+	if (const int32* QueuedIndex = QueuedResizeWork.Find(QueuedKey))
 	{
+		// the queued request may be for a destroyed widget which had the same address, point it at the new widget
+		ResizeQueue[*QueuedIndex].Comment = Comment;
 		return;
 	}
 
-	if (bProcessedAltReleased)
+	QueuedResizeWork.Add(QueuedKey, ResizeQueue.Num());
+
+	FASCResizeRequest& Request = ResizeQueue.AddDefaulted_GetRef();
+	Request.Comment = Comment;
+	Request.Work = Work;
+}
+
+void FAutoSizeCommentGraphHandler::ProcessResizeQueue()
+{
+	SET_DWORD_STAT(STAT_ASC_ResizeQueueDepth, ResizeQueue.Num());
+
+	if (ResizeQueue.Num() == 0)
 	{
 		return;
 	}
 
-	bProcessedAltReleased = true;
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FAutoSizeCommentGraphHandler::ProcessResizeQueue"), STAT_ASC_ProcessResizeQueue, STATGROUP_AutoSizeComments);
 
-	TArray<UEdGraphNode_Comment*> CommentNodes;
-	Graph->GetNodesOfClass(CommentNodes);
+	// selected comments first, then comments visible on the graph panel, then comments without a panel
+	const auto GetPriority = [](const FASCResizeRequest& Request)
+	{
+		TSharedPtr<SAutoSizeCommentsGraphNode> Comment = Request.Comment.Pin();
+		TSharedPtr<SGraphPanel> OwnerPanel = Comment ? Comment->GetOwnerPanel() : nullptr;
+		if (!OwnerPanel)
+		{
+			return 2;
+		}
 
-	TSet<UObject*> SelectedNodes;
-	for (auto Node : GraphPanel->SelectionManager.GetSelectedNodes())
+		if (OwnerPanel->SelectionManager.IsNodeSelected(Comment->GetNodeObj()))
+		{
+			return 0;
+		}
+
+		const FASCVector2 TopLeft = Comment->GetPos();
+		const FASCVector2 BottomRight = TopLeft + FASCVector2(Comment->GetDesiredSize());
+		return OwnerPanel->IsRectVisible(TopLeft, BottomRight) ? 1 : 2;
+	};
+
+	TArray<TPair<int32, int32>> SortedRequests;
+	SortedRequests.Reserve(ResizeQueue.Num());
+	for (int32 RequestIndex = 0; RequestIndex < ResizeQueue.Num(); ++RequestIndex)
 	{
-		SelectedNodes.Add(Node);
-		if (UEdGraphNode_Comment* SelectedComment = Cast<UEdGraphNode_Comment>(Node))
+		// drop the requests for destroyed widgets
+		if (ResizeQueue[RequestIndex].Comment.IsValid())
 		{
-			SelectedNodes.Append(SelectedComment->GetNodesUnderComment());
+			SortedRequests.Add(TPair<int32, int32>(GetPriority(ResizeQueue[RequestIndex]), RequestIndex));
 		}
 	}
 
-	TMap<TSharedPtr<SAutoSizeCommentsGraphNode>, const TArray<UObject*>> OldCommentContains;
-	TMap<UEdGraphNode_Comment*, TArray<UEdGraphNode_Comment*>> OldParentMap;
+	// sorting by (priority, index) keeps the order the requests were queued in
+	SortedRequests.Sort();
 
-	TArray<TSharedPtr<SAutoSizeCommentsGraphNode>> ASCGraphNodes;
-	TSet<TSharedPtr<SAutoSizeCommentsGraphNode>> ChangedGraphNodes; 
+	const double BudgetSeconds = UAutoSizeCommentsSettings::Get().ResizeQueueBudgetMs / 1000.0;
+	const double StartTime = FPlatformTime::Seconds();
 
-	// gather asc graph nodes and store the comment data for later
-	for (UEdGraphNode_Comment* CommentNode : CommentNodes)
+	// take the requests out of the queue first, processing them may queue more work
+	TArray<FASCResizeRequest> Requests;
+	Requests.Reserve(SortedRequests.Num());
+	for (int32 SortedIndex = 0; SortedIndex < SortedRequests.Num(); ++SortedIndex)
 	{
-		TSharedPtr<SAutoSizeCommentsGraphNode> ASCGraphNode = FASCState::Get().GetASCComment(CommentNode);
-		if (!ASCGraphNode)
+		FASCResizeRequest& Request = ResizeQueue[SortedRequests[SortedIndex].Value];
+		Requests.Add(MoveTemp(Request));
+	}
+
+	ResizeQueue.Reset();
+	QueuedResizeWork.Reset();
+
+	int32 NumProcessed = 0;
+	for (const FASCResizeRequest& Request : Requests)
+	{
+		// always process at least one request so the queue can't stall
+		if (NumProcessed > 0 && BudgetSeconds > 0 && FPlatformTime::Seconds() - StartTime > BudgetSeconds)
+		{
+			break;
+		}
+
+		++NumProcessed;
+
+		TSharedPtr<SAutoSizeCommentsGraphNode> Comment = Request.Comment.Pin();
+		if (!Comment)
 		{
 			continue;
 		}
 
-		if (ASCGraphNode->IsHeaderComment())
+		switch (Request.Work)
 		{
-			continue;
+			case EASCResizeWork::InitialDetectNodes:
+				Comment->InitialDetectNodes();
+				break;
+			case EASCResizeWork::ResizeToFit:
+				RequestResizeToFit(Comment);
+				break;
+			default: ;
 		}
+	}
 
-		ASCGraphNodes.Add(ASCGraphNode);
+	// requeue anything we did not get to this frame
+	for (int32 RequestIndex = NumProcessed; RequestIndex < Requests.Num(); ++RequestIndex)
+	{
+		QueueResizeWork(Requests[RequestIndex].Comment.Pin(), Requests[RequestIndex].Work);
+	}
+}
 
-		OldCommentContains.Add(ASCGraphNode, CommentNode->GetNodesUnderComment());
+void FAutoSizeCommentGraphHandler::RequestResizeToFit(TSharedPtr<SAutoSizeCommentsGraphNode> Comment)
+{
+	if (Comment)
+	{
+		PendingResizes.Add(Comment);
+	}
+}
 
-		for (UObject* ContainedObj : CommentNode->GetNodesUnderComment())
+void FAutoSizeCommentGraphHandler::ResizePendingComments()
+{
+	if (PendingResizes.Num() == 0)
+	{
+		return;
+	}
+
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FAutoSizeCommentGraphHandler::ResizePendingComments"), STAT_ASC_ResizePendingComments, STATGROUP_AutoSizeComments);
+
+	// comments can only contain comments from the same graph
+	TMap<UEdGraph*, TSet<UEdGraphNode_Comment*>> RequestsByGraph;
+	for (const TWeakPtr<SAutoSizeCommentsGraphNode>& WeakComment : PendingResizes)
+	{
+		if (TSharedPtr<SAutoSizeCommentsGraphNode> Comment = WeakComment.Pin())
 		{
-			if (UEdGraphNode_Comment* ContainedComment = Cast<UEdGraphNode_Comment>(ContainedObj))
+			UEdGraphNode_Comment* CommentNode = Comment->GetCommentNodeObj();
+			if (UEdGraph* Graph = CommentNode ? CommentNode->GetGraph() : nullptr)
 			{
-				OldParentMap.FindOrAdd(ContainedComment).Add(CommentNode);
+				RequestsByGraph.FindOrAdd(Graph).Add(CommentNode);
 			}
 		}
 	}
 
-	// update their containing nodes
-	for (TSharedPtr<SAutoSizeCommentsGraphNode> ASCGraphNode : ASCGraphNodes)
+	PendingResizes.Reset();
+
+	for (const auto& Elem : RequestsByGraph)
 	{
-		UEdGraphNode_Comment* CommentNode = ASCGraphNode->GetCommentNodeObj();
+		ResizeCommentsBottomUp(Elem.Key, Elem.Value);
+	}
+}
 
-		const ECommentCollisionMethod& AltCollisionMethod = UAutoSizeCommentsSettings::Get().AltCollisionMethod;
+void FAutoSizeCommentGraphHandler::ResizeCommentsBottomUp(UEdGraph* Graph, const TSet<UEdGraphNode_Comment*>& RequestedComments)
+{
+	TArray<UEdGraphNode_Comment*> GraphComments;
+	Graph->GetNodesOfClass<UEdGraphNode_Comment>(GraphComments);
 
-		if (SelectedNodes.Contains(CommentNode))
-		{
-			ASCGraphNode->RefreshNodesInsideComment(AltCollisionMethod, UAutoSizeCommentsSettings::Get().bIgnoreKnotNodesWhenPressingAlt, false);
-			ChangedGraphNodes.Add(ASCGraphNode);
-		}
-		else
+	// build the containment graph for this batch (child comment -> comments containing it)
+	TMap<UEdGraphNode_Comment*, TArray<UEdGraphNode_Comment*>> ParentComments;
+	for (UEdGraphNode_Comment* Parent : GraphComments)
+	{
+		for (UObject* Obj : Parent->GetNodesUnderComment())
 		{
-			TArray<UEdGraphNode*> OutNodes;
-			ASCGraphNode->QueryNodesUnderComment(OutNodes, AltCollisionMethod);
-			OutNodes = OutNodes.FilterByPredicate(SAutoSizeCommentsGraphNode::IsMajorNode);
-
-			TSet<UObject*> NewSelection(CommentNode->GetNodesUnderComment());
-			bool bChanged = false;
-			for (UObject* Node : SelectedNodes)
+			UEdGraphNode_Comment* Child = Cast<UEdGraphNode_Comment>(Obj);
+			if (!Child || Child == Parent)
 			{
-				if (OutNodes.Contains(Node))
-				{
-					bool bAlreadyInSet = false;
-					NewSelection.Add(Node, &bAlreadyInSet);
-					bChanged = !bAlreadyInSet;
-				}
-				else
-				{
-					if (NewSelection.Remove(Node) > 0)
-					{
-						bChanged = true;
-					}
-				}
+				continue;
 			}
 
-			if (bChanged)
+			// matches GetBoundsForNodesInside, the parent ignores a child which also contains it at a higher depth
+			if (Child->CommentDepth > Parent->CommentDepth && Child->GetNodesUnderComment().Contains(Parent))
 			{
-				CommentNode->ClearNodesUnderComment();
-				ASCGraphNode->AddAllNodesUnderComment(NewSelection.Array(), false);
-				ChangedGraphNodes.Add(ASCGraphNode);
+				continue;
+			}
 
-				if (UAutoSizeCommentsSettings::Get().ResizingMode != EASCResizingMode::Disabled)
+			ParentComments.FindOrAdd(Child).Add(Parent);
+		}
+	}
+
+	// parents of a requested comment may need to resize around it, so include every ancestor in the batch
+	TArray<UEdGraphNode_Comment*> Batch = RequestedComments.Array();
+	TMap<UEdGraphNode_Comment*, int32> NumPendingChildren;
+	for (UEdGraphNode_Comment* Comment : Batch)
+	{
+		NumPendingChildren.Add(Comment, 0);
+	}
+
+	for (int32 BatchIndex = 0; BatchIndex < Batch.Num(); ++BatchIndex)
+	{
+		if (const TArray<UEdGraphNode_Comment*>* Parents = ParentComments.Find(Batch[BatchIndex]))
+		{
+			for (UEdGraphNode_Comment* Parent : *Parents)
+			{
+				if (!NumPendingChildren.Contains(Parent))
 				{
-					ASCGraphNode->ResizeToFit();
+					NumPendingChildren.Add(Parent, 0);
+					Batch.Add(Parent);
 				}
 
-				ASCGraphNode->UpdateCache();
+				++NumPendingChildren[Parent];
 			}
 		}
 	}
 
-	// update existing comment nodes using the parent comments stored earlier 
-	for (TSharedPtr<SAutoSizeCommentsGraphNode> GraphNode : ChangedGraphNodes)
+	// resize from the leaves upwards (Kahn's algorithm), so each parent reads the final rect of its children
+	TArray<UEdGraphNode_Comment*> ResizeOrder;
+	ResizeOrder.Reserve(Batch.Num());
+	for (UEdGraphNode_Comment* Comment : Batch)
 	{
-		const TArray<UEdGraphNode_Comment*>* OldParents = OldParentMap.Find(GraphNode->GetCommentNodeObj());
-		const TArray<UObject*>* OldContains = OldCommentContains.Find(GraphNode);
-		GraphNode->UpdateExistingCommentNodes(OldParents, OldContains);
+		if (NumPendingChildren[Comment] == 0)
+		{
+			ResizeOrder.Add(Comment);
+		}
 	}
 
-	GEditor->GetTimerManager()->SetTimerForNextTick(FTimerDelegate::CreateLambda([&]
+	TSet<UEdGraphNode_Comment*> NeedsResize(RequestedComments);
+	TSet<UEdGraphNode_Comment*> Visited;
+	for (int32 OrderIndex = 0; OrderIndex < Batch.Num(); ++OrderIndex)
 	{
-		bProcessedAltReleased = false;
-	}));
-}
+		// anything left is part of a containment cycle, resize it in any order
+		if (OrderIndex >= ResizeOrder.Num())
+		{
+			for (UEdGraphNode_Comment* Comment : Batch)
+			{
+				if (!Visited.Contains(Comment))
+				{
+					ResizeOrder.Add(Comment);
+					break;
+				}
+			}
+		}
 
-FASCGraphHandlerData& FAutoSizeCommentGraphHandler::GetGraphHandlerData(UEdGraph* Graph)
-{
-	if (!GraphDatas.Contains(Graph))
-	{
-		FASCGraphHandlerData GraphData;
+		UEdGraphNode_Comment* Comment = ResizeOrder[OrderIndex];
+		Visited.Add(Comment);
 
-		// read comments that already exist in the graph
-		for (auto Node : Graph->Nodes)
+		bool bChanged = false;
+		if (NeedsResize.Contains(Comment))
 		{
-			if (auto Comment = Cast<UEdGraphNode_Comment>(Node))
+			if (TSharedPtr<SAutoSizeCommentsGraphNode> ASCComment = FASCState::Get().GetASCComment(Comment))
 			{
-				GraphData.InitialComments.Add(Comment);
+				bChanged = ASCComment->ResizeToFit();
 			}
 		}
 
-		GraphData.OnGraphChangedHandle = Graph->AddOnGraphChangedHandler(FOnGraphChanged::FDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::OnGraphChanged));
-		GraphDatas.Add(Graph, GraphData);
-	}
+		if (const TArray<UEdGraphNode_Comment*>* Parents = ParentComments.Find(Comment))
+		{
+			for (UEdGraphNode_Comment* Parent : *Parents)
+			{
+				if (bChanged)
+				{
+					NeedsResize.Add(Parent);
+				}
 
-	return GraphDatas[Graph]; 
+				if (--NumPendingChildren[Parent] == 0 && !Visited.Contains(Parent))
+				{
+					ResizeOrder.Add(Parent);
+				}
+			}
+		}
+	}
 }
 
-void FAutoSizeCommentGraphHandler::UpdateCommentChangeState(UEdGraphNode_Comment* Comment)
+void FAutoSizeCommentGraphHandler::MarkDraggedNodesDirty()
 {
-	UEdGraph* Graph = Comment->GetGraph();
-	if (!Graph)
+	// nodes are dragged with the left mouse button, the other buttons pan the graph
+	if (!FSlateApplication::Get().GetPressedMouseButtons().Contains(EKeys::LeftMouseButton))
 	{
 		return;
 	}
 
-	FASCGraphHandlerData& GraphData = GetGraphHandlerData(Graph);
-	GraphData.CommentChangeData.FindOrAdd(Comment->NodeGuid).UpdateComment(Comment);
-}
-
-bool FAutoSizeCommentGraphHandler::HasCommentChangeState(UEdGraphNode_Comment* Comment) const
-{
-	if (UEdGraph* Graph = Comment->GetGraph())
+	for (TWeakPtr<SGraphPanel> GraphPanelPtr : ActiveGraphPanels)
 	{
-		if (const FASCGraphHandlerData* GraphData = GraphDatas.Find(Graph))
+		TSharedPtr<SGraphPanel> GraphPanel = GraphPanelPtr.Pin();
+		FASCGraphHandlerData* GraphData = GraphPanel ? GraphDatas.Find(GraphPanel->GetGraphObj()) : nullptr;
+		if (!GraphData)
 		{
-			return GraphData->CommentChangeData.Contains(Comment->NodeGuid);
+			continue;
 		}
-	}
-
-	return false;
-}
 
-bool FAutoSizeCommentGraphHandler::HasCommentChanged(UEdGraphNode_Comment* Comment)
-{
-	if (FASCGraphHandlerData* GraphData = GraphDatas.Find(Comment->GetGraph()))
-	{
-		if (FASCCommentChangeData* CommentChangeData = GraphData->CommentChangeData.Find(Comment->NodeGuid))
+		UEdGraphNode* ProbeNode = nullptr;
+		for (UObject* SelectedObj : GraphPanel->SelectionManager.SelectedNodes)
 		{
-			return CommentChangeData->HasCommentChanged(Comment);
+			ProbeNode = Cast<UEdGraphNode>(SelectedObj);
+			if (ProbeNode)
+			{
+				break;
+			}
 		}
-	}
-
-	return false;
-}
-
-TArray<UEdGraph*> FAutoSizeCommentGraphHandler::GetActiveGraphs()
-{
-	TArray<TWeakObjectPtr<UEdGraph>> GraphWeakPtrs;
-	GraphDatas.GetKeys(GraphWeakPtrs);
 
-	TArray<UEdGraph*> ActiveGraphs;
-
-	for (TWeakObjectPtr<UEdGraph> GraphWeakPtr : GraphWeakPtrs)
-	{
-		if (GraphWeakPtr.IsValid())
+		if (!ProbeNode)
 		{
-			ActiveGraphs.Add(GraphWeakPtr.Get());
+			continue;
 		}
-	}
 
-	return ActiveGraphs;
-}
+		// the selected nodes move together, so one of them having moved since last tick means they are being dragged
+		const FIntPoint ProbePos(ProbeNode->NodePosX, ProbeNode->NodePosY);
+		const bool bMoved = GraphData->DragProbeNode.Get() == ProbeNode && GraphData->DragProbePos != ProbePos;
+		GraphData->DragProbeNode = ProbeNode;
+		GraphData->DragProbePos = ProbePos;
 
-TArray<TSharedPtr<SGraphPanel>> FAutoSizeCommentGraphHandler::GetActiveGraphPanels()
-{
-	TArray<TSharedPtr<SGraphPanel>> OutGraphPanels;
-	for (TWeakPtr<SGraphPanel> ActiveGraphPanel : ActiveGraphPanels)
-	{
-		if (ActiveGraphPanel.IsValid())
+		if (bMoved)
 		{
-			OutGraphPanels.Add(ActiveGraphPanel.Pin());
+			for (UObject* SelectedObj : GraphPanel->SelectionManager.SelectedNodes)
+			{
+				MarkContainingCommentsDirty(Cast<UEdGraphNode>(SelectedObj));
+			}
 		}
 	}
-
-	return OutGraphPanels;
-}
-
-bool FAutoSizeCommentGraphHandler::Tick(float DeltaTime)
-{
-	UpdateNodeUnrelatedState();
-
-	return true;
 }
 
 void FAutoSizeCommentGraphHandler::UpdateNodeUnrelatedState()
 {
-	if (!UAutoSizeCommentsSettings::Get().bHighlightContainingNodesOnSelection)
+	// the selection can only change from input or a select graph action
+	if (!bSelectionDirty || !UAutoSizeCommentsSettings::Get().bHighlightContainingNodesOnSelection)
 	{
 		return;
 	}
 
+	bSelectionDirty = false;
+
 	// iterate by graph panel to access the selection manager (otherwise we could use the graph)
 	for (int i = ActiveGraphPanels.Num() - 1; i >= 0; --i)
 	{
@@ -741,11 +1879,7 @@ void FAutoSizeCommentGraphHandler::UpdateNodeUnrelatedState()
 			// if we deselected everything, clear the unrelated nodes and empty the last selection set
 			if (SelectedComments.Num() == 0 && GraphData->LastSelectionSet.Num() != 0)
 			{
-				for (UEdGraphNode* Node : Graph->Nodes)
-				{
-					Node->SetNodeUnrelated(false);
-				}
-
+				GraphData->Highlight.Reset(Graph);
 				GraphData->LastSelectionSet.Empty();
 				continue;
 			}
@@ -781,20 +1915,14 @@ void FAutoSizeCommentGraphHandler::UpdateNodeUnrelatedState()
 
 			if (bRefreshSelectedNodes)
 			{
-				for (UEdGraphNode* Node : Graph->Nodes)
-				{
-					Node->SetNodeUnrelated(true);
-				}
-
+				TSet<UEdGraphNode*> RelatedNodes;
 				for (TWeakObjectPtr<UEdGraphNode_Comment> Comment : GraphData->LastSelectionSet)
 				{
-					Comment->SetNodeUnrelated(false);
-
-					for (UEdGraphNode* Node : FASCUtils::GetNodesUnderComment(Comment.Get()))
-					{
-						Node->SetNodeUnrelated(false);
-					}
+					RelatedNodes.Add(Comment.Get());
+					RelatedNodes.Append(FASCUtils::GetNodesUnderComment(Comment.Get()));
 				}
+
+				GraphData->Highlight.SetRelatedNodes(Graph, RelatedNodes);
 			}
 		}
 	}
@@ -806,10 +1934,34 @@ void FAutoSizeCommentGraphHandler::ClearUnrelatedNodes()
 	{
 		if (Elem.Key.IsValid())
 		{
-			for (UEdGraphNode* NodeToUpdate : Elem.Key->Nodes)
-			{
-				NodeToUpdate->SetNodeUnrelated(false);
-			}
+			Elem.Value.Highlight.Reset(Elem.Key.Get());
+		}
+	}
+}
+
+void FAutoSizeCommentGraphHandler::SetNodesRelated(UEdGraph* Graph, const TSet<UEdGraphNode*>& Nodes)
+{
+	if (Graph)
+	{
+		GetGraphHandlerData(Graph).Highlight.SetRelatedNodes(Graph, Nodes);
+	}
+}
+
+void FAutoSizeCommentGraphHandler::SetNodeRelated(UEdGraphNode* Node, bool bRelated)
+{
+	if (UEdGraph* Graph = Node ? Node->GetGraph() : nullptr)
+	{
+		GetGraphHandlerData(Graph).Highlight.SetNodeRelated(Node, bRelated);
+	}
+}
+
+void FAutoSizeCommentGraphHandler::ResetNodesUnrelated(UEdGraph* Graph)
+{
+	if (Graph)
+	{
+		if (FASCGraphHandlerData* GraphData = GraphDatas.Find(Graph))
+		{
+			GraphData->Highlight.Reset(Graph);
 		}
 	}
 }
@@ -896,14 +2048,14 @@ void FAutoSizeCommentGraphHandler::OnNodeDeleted(const FEdGraphEditAction& Actio
 	// remove any deleted nodes from their containing comments
 	if (Action.Graph)
 	{
-		TArray<UEdGraphNode_Comment*> Comments;
-		Action.Graph->GetNodesOfClass<UEdGraphNode_Comment>(Comments);
-
 		// is there a better way of converting this set of const ptrs to non-const ptrs?
 		TSet<UObject*> NodeToRemove;
+		TSet<UEdGraphNode_Comment*> Comments;
 		for (const UEdGraphNode* Node : Action.Nodes)
 		{
-			NodeToRemove.Add(const_cast<UEdGraphNode*>(Node));
+			UEdGraphNode* MutableNode = const_cast<UEdGraphNode*>(Node);
+			NodeToRemove.Add(MutableNode);
+			Comments.Append(GetContainingComments(MutableNode));
 		}
 
 		for (UEdGraphNode_Comment* Comment : Comments)
@@ -936,10 +2088,7 @@ void FAutoSizeCommentGraphHandler::OnNodeDeleted(const FEdGraphEditAction& Actio
 
 	if (bResetUnrelatedNodes)
 	{
-		for (UEdGraphNode* NodeToUpdate : Action.Graph->Nodes)
-		{
-			NodeToUpdate->SetNodeUnrelated(false);
-		}
+		ResetNodesUnrelated(Action.Graph);
 	}
 }
 
@@ -970,11 +2119,7 @@ void FAutoSizeCommentGraphHandler::OnObjectSaved(UObject* Object)
 		TArray<UEdGraphNode_Comment*> Comments;
 		Graph->GetNodesOfClassEx<UEdGraphNode_Comment>(Comments);
 
-		if (!bPendingSave)
-		{
-			bPendingSave = true;
-			GEditor->GetTimerManager()->SetTimerForNextTick(FTimerDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::SaveSizeCache));
-		}
+		FASCDeferredWork::Get().Request(EASCDeferredWork::SaveSizeCache, this, FSimpleDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::SaveSizeCache));
 
 		if (UAutoSizeCommentsSettings::Get().CacheSaveMethod == EASCCacheSaveMethod::MetaData)
 		{
@@ -996,6 +2141,34 @@ void FAutoSizeCommentGraphHandler::OnObjectTransacted(UObject* Object, const FTr
 		return;
 	}
 
+	if (Event.GetEventType() == ETransactionObjectEventType::UndoRedo)
+	{
+		if (UEdGraph* Graph = Cast<UEdGraph>(Object))
+		{
+			MarkGraphDirty(Graph);
+			FAutoSizeCommentsCacheFile::Get().MarkNeedsCleanup(Graph);
+
+			if (FASCGraphHandlerData* GraphData = GraphDatas.Find(Graph))
+			{
+				GraphData->LiveNodes.bStale = true;
+				GraphData->ContainmentIndex.bStale = true;
+				GraphData->CommentReachability.bStale = true;
+			}
+		}
+	}
+
+	if (UEdGraphNode* Node = Cast<UEdGraphNode>(Object))
+	{
+		if (Event.GetEventType() == ETransactionObjectEventType::UndoRedo)
+		{
+			MarkGraphDirty(Node->GetGraph());
+		}
+		else
+		{
+			MarkContainingCommentsDirty(Node);
+		}
+	}
+
 	// we are probably currently dragging a node around so don't update now
 	if (FSlateApplication::Get().GetModifierKeys().IsAltDown())
 	{
@@ -1009,23 +2182,78 @@ void FAutoSizeCommentGraphHandler::OnObjectTransacted(UObject* Object, const FTr
 		{
 			if (GetResizingMode(Node->GetGraph()) != EASCResizingMode::Disabled)
 			{
-				GEditor->GetTimerManager()->SetTimerForNextTick(FTimerDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::UpdateContainingComments, TWeakObjectPtr<UEdGraphNode>(Node)));
+				FASCDeferredWork::Get().Request(EASCDeferredWork::UpdateContainingComments, Node,
+					FSimpleDelegate::CreateRaw(this, &FAutoSizeCommentGraphHandler::UpdateContainingComments, TWeakObjectPtr<UEdGraphNode>(Node)));
 			}
 		}
 		
 	}
 }
 
+void FAutoSizeCommentGraphHandler::OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& Event)
+{
+	if (UEdGraphNode* Node = Cast<UEdGraphNode>(Object))
+	{
+		MarkContainingCommentsDirty(Node);
+	}
+}
+
+void FAutoSizeCommentGraphHandler::OnBlueprintCompiled()
+{
+	// compiling can reconstruct any node without notifying the graph
+	for (auto& Elem : GraphDatas)
+	{
+		++Elem.Value.DirtyGeneration;
+		Elem.Value.NodeChangeCache.InvalidateAll();
+	}
+}
+
+void FAutoSizeCommentGraphHandler::PollCommentsForChanges(UEdGraph* Graph, FASCGraphHandlerData& GraphData, float DeltaTime)
+{
+	const int32 NumNodes = Graph->Nodes.Num();
+	if (NumNodes == 0)
+	{
+		return;
+	}
+
+	const float NodesPerSecond = NumNodes / UAutoSizeCommentsSettings::Get().ChangePollInterval;
+	GraphData.PollNodeProgress = FMath::Min(GraphData.PollNodeProgress + NodesPerSecond * DeltaTime, static_cast<float>(NumNodes));
+
+	const int32 NumToCheck = FMath::Min(FMath::FloorToInt(GraphData.PollNodeProgress), NumNodes);
+	GraphData.PollNodeProgress -= NumToCheck;
+
+	for (int32 i = 0; i < NumToCheck; ++i)
+	{
+		// finished a full cycle, also check the live nodes and node rects in case they changed without a notification
+		if (GraphData.PollNodeIndex >= NumNodes)
+		{
+			GraphData.PollNodeIndex = 0;
+			FindLiveNodes(Graph);
+			GraphData.SpatialIndex.MarkDirty();
+		}
+
+		// polling is for changes without a notification, so the cached node hashes must be recalculated
+		if (UEdGraphNode_Comment* Comment = Cast<UEdGraphNode_Comment>(Graph->Nodes[GraphData.PollNodeIndex++]))
+		{
+			MarkCommentDirty(Comment);
+		}
+	}
+}
+
 void FAutoSizeCommentGraphHandler::OnPostGarbageCollect()
 {
 	// cleanup invalid graphs
 	GraphDatas.Remove(nullptr);
+
+	for (auto& Elem : GraphDatas)
+	{
+		Elem.Value.NodeChangeCache.RemoveStaleNodes();
+	}
 }
 
 void FAutoSizeCommentGraphHandler::SaveSizeCache()
 {
 	FAutoSizeCommentsCacheFile::Get().SaveCacheToFile();
-	bPendingSave = false;
 }
 
 void FAutoSizeCommentGraphHandler::UpdateContainingComments(TWeakObjectPtr<UEdGraphNode> Node)
@@ -1043,7 +2271,8 @@ void FAutoSizeCommentGraphHandler::UpdateContainingComments(TWeakObjectPtr<UEdGr
 
 	TArray<UEdGraphNode_Comment*> Comments;
 
-	// check if any node on the graph contains the new node
+	// this runs after an undo or redo, where the live nodes under a comment may not match what the comment
+	// had saved, so check the cache file rather than the containment index (only once per transaction)
 	Graph->GetNodesOfClass<UEdGraphNode_Comment>(Comments);
 	for (UEdGraphNode_Comment* Comment : Comments)
 	{
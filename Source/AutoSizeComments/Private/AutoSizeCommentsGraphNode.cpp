@@ -3,6 +3,7 @@
 #include "AutoSizeCommentsGraphNode.h"
 
 #include "AutoSizeCommentsCacheFile.h"
+#include "AutoSizeCommentsDeferredWork.h"
 #include "AutoSizeCommentsGraphHandler.h"
 #include "AutoSizeCommentsInputProcessor.h"
 #include "AutoSizeCommentsModule.h"
@@ -18,6 +19,7 @@
 #include "ScopedTransaction.h"
 #include "SGraphPanel.h"
 #include "TutorialMetaData.h"
+#include "Algo/Sort.h"
 #include "Framework/Application/SlateApplication.h"
 #include "MaterialGraph/MaterialGraphNode_Comment.h"
 #include "Materials/MaterialExpressionComment.h"
@@ -258,6 +260,8 @@ FReply SAutoSizeCommentsGraphNode::OnMouseButtonDown(const FGeometry& MyGeometry
 		{
 			DragSize = UserSize;
 			bUserIsDragging = true;
+			LastDragQueryRect.Reset();
+			DragNodesUnderComment.Reset();
 
 			// deselect all nodes when we are trying to resize
 			GetOwnerPanel()->SelectionManager.ClearSelectionSet();
@@ -288,6 +292,8 @@ FReply SAutoSizeCommentsGraphNode::OnMouseButtonUp(const FGeometry& MyGeometry,
 	if (bUserIsDragging)
 	{
 		ResetNodesUnrelated();
+		LastDragQueryRect.Reset();
+		DragNodesUnderComment.Reset();
 	}
 
 	if ((MouseEvent.GetEffectingButton() == GetResizeKey()) && bUserIsDragging)
@@ -376,14 +382,91 @@ FReply SAutoSizeCommentsGraphNode::OnMouseMove(const FGeometry& MyGeometry, cons
 			}
 		}
 
+		UpdateDragNodesRelated();
+	}
+
+	return SGraphNode::OnMouseMove(MyGeometry, MouseEvent);
+}
+
+void SAutoSizeCommentsGraphNode::UpdateDragNodesRelated()
+{
 #if ASC_UE_VERSION_OR_LATER(4, 23)
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("SAutoSizeCommentsGraphNode::UpdateDragNodesRelated"), STAT_ASC_UpdateDragNodesRelated, STATGROUP_AutoSizeComments);
+
+	TSharedPtr<SGraphPanel> OwnerPanel = GetOwnerPanel();
+	if (!OwnerPanel)
+	{
+		return;
+	}
+
+	const ECommentCollisionMethod CollisionMethod = UAutoSizeCommentsSettings::Get().ResizeCollisionMethod;
+	const FSlateRect NewRect = GetCommentCollisionRect();
+
+	// first move of the drag, query the whole comment
+	if (!LastDragQueryRect.IsSet())
+	{
 		TArray<UEdGraphNode*> Nodes;
-		QueryNodesUnderComment(Nodes, UAutoSizeCommentsSettings::Get().ResizeCollisionMethod);
+		QueryNodesUnderComment(Nodes, CollisionMethod);
 		SetNodesRelated(Nodes);
-#endif
+
+		DragNodesUnderComment = TSet<UEdGraphNode*>(Nodes);
+		LastDragQueryRect = NewRect;
+		return;
 	}
 
-	return SGraphNode::OnMouseMove(MyGeometry, MouseEvent);
+	const FSlateRect OldRect = LastDragQueryRect.GetValue();
+	if (OldRect == NewRect)
+	{
+		return;
+	}
+
+	LastDragQueryRect = NewRect;
+
+	// a node can only enter or leave the comment if it overlaps the area between the old and new rect
+	TArray<FSlateRect> ChangedAreas;
+	FASCNodeSpatialIndex::SubtractRect(NewRect, OldRect, ChangedAreas);
+	FASCNodeSpatialIndex::SubtractRect(OldRect, NewRect, ChangedAreas);
+
+	FASCNodeSpatialIndex& SpatialIndex = FAutoSizeCommentGraphHandler::Get().GetSpatialIndex(OwnerPanel);
+
+	TArray<TSharedRef<SGraphNode>> Candidates;
+	for (const FSlateRect& ChangedArea : ChangedAreas)
+	{
+		SpatialIndex.QueryNodes(ChangedArea.ExtendBy(1), ECommentCollisionMethod::Intersect, Candidates);
+	}
+
+	TSet<UEdGraphNode*> TestedNodes;
+	for (const TSharedRef<SGraphNode>& Candidate : Candidates)
+	{
+		UEdGraphNode* Node = Candidate->GetNodeObj();
+		if (!Node || Node == CommentNode)
+		{
+			continue;
+		}
+
+		bool bAlreadyTested = false;
+		TestedNodes.Add(Node, &bAlreadyTested);
+		if (bAlreadyTested)
+		{
+			continue;
+		}
+
+		const FSlateRect NodeRect = FASCNodeSpatialIndex::GetNodeWidgetRect(Candidate.Get());
+		if (FASCNodeSpatialIndex::DoesCollide(CollisionMethod, NewRect, NodeRect))
+		{
+			bool bAlreadyUnderComment = false;
+			DragNodesUnderComment.Add(Node, &bAlreadyUnderComment);
+			if (!bAlreadyUnderComment)
+			{
+				FAutoSizeCommentGraphHandler::Get().SetNodeRelated(Node, true);
+			}
+		}
+		else if (DragNodesUnderComment.Remove(Node) > 0)
+		{
+			FAutoSizeCommentGraphHandler::Get().SetNodeRelated(Node, false);
+		}
+	}
+#endif
 }
 
 FReply SAutoSizeCommentsGraphNode::OnMouseButtonDoubleClick(const FGeometry& InMyGeometry, const FPointerEvent& InMouseEvent)
@@ -430,9 +513,15 @@ void SAutoSizeCommentsGraphNode::Tick(const FGeometry& AllottedGeometry, const d
 
 	bAreControlsEnabled = !AreResizeModifiersDown(false) && (!UAutoSizeCommentsSettings::Get().EnableCommentControlsKey.Key.IsValid() || bAreControlsEnabled);
 
+	// only check for changes when the graph handler has marked us dirty
+	const bool bIsDirty = FAutoSizeCommentGraphHandler::Get().ConsumeCommentDirty(CommentNode, LastDirtyGeneration);
+
 	// We need to call this on tick since there are quite a few methods of deleting
 	// nodes without any callbacks (undo, collapse to function / macro...)
-	RemoveInvalidNodes();
+	if (bIsDirty)
+	{
+		RemoveInvalidNodes();
+	}
 
 	const EASCResizingMode ResizingMode = GetResizingMode();
 
@@ -472,23 +561,36 @@ void SAutoSizeCommentsGraphNode::Tick(const FGeometry& AllottedGeometry, const d
 			{
 				ResizeToFit();
 			}
-			else if (ResizingMode == EASCResizingMode::Reactive &&
+			else if (ResizingMode == EASCResizingMode::Reactive && bIsDirty &&
 				FAutoSizeCommentGraphHandler::Get().HasCommentChanged(CommentNode))
 			{
 				FAutoSizeCommentGraphHandler::Get().UpdateCommentChangeState(CommentNode);
-				ResizeToFit();
+				FAutoSizeCommentGraphHandler::Get().RequestResizeToFit(SharedThis(this));
 			}
 
-			MoveEmptyCommentBoxes();
+			if (bIsDirty)
+			{
+				MoveEmptyCommentBoxes();
+			}
 
 			// if (ResizeTransaction.IsValid())
 			// {
 			// 	ResizeTransaction.Reset();
 			// }
 		}
+		else if (bIsDirty)
+		{
+			// the change is checked once alt is released
+			FAutoSizeCommentGraphHandler::Get().MarkCommentDirty(CommentNode);
+		}
 
 		bPreviousAltDown = bIsAltDown;
 	}
+	else if (bIsDirty && !IsHeaderComment())
+	{
+		// the change is checked once the drag ends
+		FAutoSizeCommentGraphHandler::Get().MarkCommentDirty(CommentNode);
+	}
 
 	SGraphNode::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
 
@@ -499,11 +601,14 @@ void SAutoSizeCommentsGraphNode::Tick(const FGeometry& AllottedGeometry, const d
 	}
 
 	// Update cached title
-	const FString CurrentCommentTitle = GetNodeComment();
-	if (CurrentCommentTitle != CachedCommentTitle)
+	if (bIsDirty)
 	{
-		OnTitleChanged(CachedCommentTitle, CurrentCommentTitle);
-		CachedCommentTitle = CurrentCommentTitle;
+		const FString CurrentCommentTitle = GetNodeComment();
+		if (CurrentCommentTitle != CachedCommentTitle)
+		{
+			OnTitleChanged(CachedCommentTitle, CurrentCommentTitle);
+			CachedCommentTitle = CurrentCommentTitle;
+		}
 	}
 
 	// Update cached width
@@ -780,8 +885,8 @@ void SAutoSizeCommentsGraphNode::SetOwner(const TSharedRef<SGraphPanel>& OwnerPa
 		}
 	};
 
-	const auto Delegate = FTimerDelegate::CreateLambda(InitNode, SharedThis(this), InitialSelectedNodes);
-	GEditor->GetTimerManager()->SetTimerForNextTick(Delegate);
+	const auto Delegate = FSimpleDelegate::CreateLambda(InitNode, SharedThis(this), InitialSelectedNodes);
+	FASCDeferredWork::Get().Request(EASCDeferredWork::InitializeComment, this, Delegate);
 }
 
 
@@ -837,6 +942,7 @@ void SAutoSizeCommentsGraphNode::InitializeASCNode(const TArray<TWeakObjectPtr<U
 		if (!CommentData.HasBeenInitialized())
 		{
 			CommentData.SetInitialized(true);
+			FAutoSizeCommentsCacheFile::Get().MarkCommentDirty(CommentNode);
 
 			// don't initialize without any selected nodes!
 			const bool bShouldApplyColor = !bHasBeenCopyPasted && (!IsExistingComment() || UAutoSizeCommentsSettings::Get().bApplyColorToExistingNodes);
@@ -884,7 +990,7 @@ void SAutoSizeCommentsGraphNode::InitializeNodesUnderComment(const TArray<TWeakO
 	// if this node is selected then we have been copy pasted, don't add all selected nodes
 	if (InitialSelectedNodes.Contains(CommentNode))
 	{
-		GEditor->GetTimerManager()->SetTimerForNextTick(FTimerDelegate::CreateRaw(this, &SAutoSizeCommentsGraphNode::InitialDetectNodes));
+		FAutoSizeCommentGraphHandler::Get().QueueResizeWork(SharedThis(this), EASCResizeWork::InitialDetectNodes);
 		return;
 	}
 
@@ -910,14 +1016,14 @@ void SAutoSizeCommentsGraphNode::InitializeNodesUnderComment(const TArray<TWeakO
 		}
 
 		AddAllNodesUnderComment(SelectedNodes.Array());
-		GEditor->GetTimerManager()->SetTimerForNextTick(FTimerDelegate::CreateRaw(this, &SAutoSizeCommentsGraphNode::ResizeToFit));
+		FAutoSizeCommentGraphHandler::Get().QueueResizeWork(SharedThis(this), EASCResizeWork::ResizeToFit);
 		return;
 	}
 
 	if (UAutoSizeCommentsSettings::Get().bDetectNodesContainedForNewComments)
 	{
 		// Refresh the nodes under the comment
-		GEditor->GetTimerManager()->SetTimerForNextTick(FTimerDelegate::CreateRaw(this, &SAutoSizeCommentsGraphNode::InitialDetectNodes));
+		FAutoSizeCommentGraphHandler::Get().QueueResizeWork(SharedThis(this), EASCResizeWork::InitialDetectNodes);
 	}
 }
 
@@ -932,7 +1038,7 @@ void SAutoSizeCommentsGraphNode::InitialDetectNodes()
 
 	if (IsExistingComment() && UAutoSizeCommentsSettings::Get().bResizeExistingNodes)
 	{
-		ResizeToFit();
+		FAutoSizeCommentGraphHandler::Get().RequestResizeToFit(SharedThis(this));
 	}
 	// else - we have been copy pasted don't resize
 
@@ -1116,15 +1222,18 @@ bool SAutoSizeCommentsGraphNode::AddAllSelectedNodes(bool bExpandComments)
 	}
 
 	TSet<UEdGraphNode*> NodesToAdd = FASCUtils::GetSelectedNodes(GetOwnerPanel(), bExpandComments);
+	FASCCommentNodesEdit Edit(CommentNode);
 	for (UEdGraphNode* SelectedObj : NodesToAdd)
 	{
 		if (CanAddNode(SelectedObj))
 		{
-			FASCUtils::AddNodeIntoComment(CommentNode, SelectedObj, false);
+			Edit.Add(SelectedObj);
 			bDidAddAnything = true;
 		}
 	}
 
+	Edit.Commit(false);
+
 	UpdateCache();
 
 	if (bDidAddAnything)
@@ -1138,15 +1247,18 @@ bool SAutoSizeCommentsGraphNode::AddAllSelectedNodes(bool bExpandComments)
 bool SAutoSizeCommentsGraphNode::AddAllNodesUnderComment(const TArray<UObject*>& Nodes, const bool bUpdateExistingComments)
 {
 	bool bDidAddAnything = false;
+	FASCCommentNodesEdit Edit(CommentNode);
 	for (UObject* Node : Nodes)
 	{
 		if (CanAddNode(Node))
 		{
-			FASCUtils::AddNodeIntoComment(CommentNode, Node);
+			Edit.Add(Node);
 			bDidAddAnything = true;
 		}
 	}
 
+	Edit.Commit();
+
 	if (bDidAddAnything && bUpdateExistingComments)
 	{
 		UpdateExistingCommentNodes();
@@ -1174,9 +1286,17 @@ bool SAutoSizeCommentsGraphNode::IsValidGraphPanel(TSharedPtr<SGraphPanel> Graph
 void SAutoSizeCommentsGraphNode::RemoveInvalidNodes()
 {
 	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("SAutoSizeCommentsGraphNode::RemoveInvalidNodes"), STAT_ASC_RemoveInvalidNodes, STATGROUP_AutoSizeComments);
-	const TArray<UObject*>& UnfilteredNodesUnderComment = CommentNode->GetNodesUnderComment();
 
-	const TArray<UEdGraphNode*>& GraphNodes = GetOwnerPanel()->GetGraphObj()->Nodes;
+	// only re-validate after nodes have been added to or removed from the graph
+	const uint32 LiveNodeGeneration = FAutoSizeCommentGraphHandler::Get().GetLiveNodeGeneration(CommentNode->GetGraph());
+	if (LiveNodeGeneration != 0 && LiveNodeGeneration == LastLiveNodeGeneration)
+	{
+		return;
+	}
+
+	LastLiveNodeGeneration = LiveNodeGeneration;
+
+	const TArray<UObject*>& UnfilteredNodesUnderComment = CommentNode->GetNodesUnderComment();
 
 	// Remove all invalid objects
 	TSet<UObject*> InvalidObjects;
@@ -1187,7 +1307,7 @@ void SAutoSizeCommentsGraphNode::RemoveInvalidNodes()
 
 		// If a node gets deleted it can still stay inside the comment box
 		// So checks if the node is still on the graph
-		if (!GraphNodes.Contains(Obj))
+		if (HasNodeBeenDeleted(Cast<UEdGraphNode>(Obj)))
 		{
 			InvalidObjects.Add(Obj);
 		}
@@ -1200,28 +1320,18 @@ bool SAutoSizeCommentsGraphNode::RemoveAllSelectedNodes(bool bExpandComments)
 {
 	TSharedPtr<SGraphPanel> OwnerPanel = GetOwnerPanel();
 
-	bool bDidRemoveAnything = false;
-
 	// const FGraphPanelSelectionSet SelectedNodes = OwnerPanel->SelectionManager.GetSelectedNodes();
 	TSet<UEdGraphNode*> SelectedNodes = FASCUtils::GetSelectedNodes(GetOwnerPanel(), bExpandComments);
-	TArray<UEdGraphNode*> NodesUnderComment = GetNodesUnderComment();
-
-	// Clear all nodes under comment
-	FASCUtils::ClearCommentNodes(CommentNode, false);
 
-	// Add back the nodes under comment while filtering out any which are selected
-	for (UEdGraphNode* NodeUnderComment : NodesUnderComment)
+	// Remove the selected nodes in a single edit
+	FASCCommentNodesEdit Edit(CommentNode);
+	for (UEdGraphNode* SelectedNode : SelectedNodes)
 	{
-		if (!SelectedNodes.Contains(NodeUnderComment))
-		{
-			FASCUtils::AddNodeIntoComment(CommentNode, NodeUnderComment, false);
-		}
-		else
-		{
-			bDidRemoveAnything = true;
-		}
+		Edit.Remove(SelectedNode);
 	}
 
+	const bool bDidRemoveAnything = Edit.Commit(false);
+
 	UpdateCache();
 
 	if (bDidRemoveAnything)
@@ -1300,15 +1410,18 @@ void SAutoSizeCommentsGraphNode::RefreshNodesInsideComment(const ECommentCollisi
 		return;
 	}
 
-	FASCUtils::ClearCommentNodes(CommentNode, false);
+	FASCCommentNodesEdit Edit(CommentNode);
+	Edit.Clear();
 	for (UEdGraphNode* Node : OutNodes)
 	{
 		if (CanAddNode(Node, bIgnoreKnots))
 		{
-			FASCUtils::AddNodeIntoComment(CommentNode, Node, false);
+			Edit.Add(Node);
 		}
 	}
 
+	Edit.Commit(false);
+
 	if (bUpdateExistingComments)
 	{
 		UpdateExistingCommentNodes();
@@ -1322,21 +1435,121 @@ float SAutoSizeCommentsGraphNode::GetTitleBarHeight() const
 	return TitleBar.IsValid() ? TitleBar->GetDesiredSize().Y : 0.0f;
 }
 
-void SAutoSizeCommentsGraphNode::UpdateExistingCommentNodes()
+TSet<UEdGraphNode_Comment*> FASCNestingChanges::GetChangedParents() const
+{
+	TSet<UEdGraphNode_Comment*> Parents;
+	for (const TPair<UEdGraphNode_Comment*, UEdGraphNode_Comment*>& Edge : Added)
+	{
+		Parents.Add(Edge.Key);
+	}
+
+	for (const TPair<UEdGraphNode_Comment*, UEdGraphNode_Comment*>& Edge : Removed)
+	{
+		Parents.Add(Edge.Key);
+	}
+
+	return Parents;
+}
+
+namespace ASCNestingInference
+{
+	/** Major nodes under the comment sorted by address, so two sets can be compared with a single merge */
+	void GetSortedMajorNodes(UEdGraphNode_Comment* Comment, TArray<UObject*>& OutNodes)
+	{
+		OutNodes.Reset();
+		for (UObject* Obj : Comment->GetNodesUnderComment())
+		{
+			if (Obj && SAutoSizeCommentsGraphNode::IsMajorNode(Obj))
+			{
+				OutNodes.Add(Obj);
+			}
+		}
+
+		Algo::Sort(OutNodes);
+	}
+
+	/** Number of nodes in both sorted sets */
+	int32 CountSharedNodes(const TArray<UObject*>& A, const TArray<UObject*>& B)
+	{
+		int32 NumShared = 0;
+		int32 IndexA = 0;
+		int32 IndexB = 0;
+		while (IndexA < A.Num() && IndexB < B.Num())
+		{
+			if (A[IndexA] < B[IndexB])
+			{
+				++IndexA;
+			}
+			else if (B[IndexB] < A[IndexA])
+			{
+				++IndexB;
+			}
+			else
+			{
+				++NumShared;
+				++IndexA;
+				++IndexB;
+			}
+		}
+
+		return NumShared;
+	}
+
+	void AddEdgeChanges(UEdGraphNode_Comment* Comment, const TArray<UEdGraphNode_Comment*>& OldComments, const TArray<UEdGraphNode_Comment*>& NewComments, bool bIsParent, FASCNestingChanges& OutChanges)
+	{
+		const auto MakeEdge = [Comment, bIsParent](UEdGraphNode_Comment* Other)
+		{
+			return bIsParent ? MakeTuple(Other, Comment) : MakeTuple(Comment, Other);
+		};
+
+		for (UEdGraphNode_Comment* Other : NewComments)
+		{
+			if (!OldComments.Contains(Other))
+			{
+				OutChanges.Added.Add(MakeEdge(Other));
+			}
+		}
+
+		for (UEdGraphNode_Comment* Other : OldComments)
+		{
+			if (!NewComments.Contains(Other))
+			{
+				OutChanges.Removed.Add(MakeEdge(Other));
+			}
+		}
+	}
+}
+
+FASCNestingChanges SAutoSizeCommentsGraphNode::UpdateExistingCommentNodes()
 {
-	UpdateExistingCommentNodes(nullptr, nullptr);
+	return UpdateExistingCommentNodes(nullptr, nullptr);
 }
 
-void SAutoSizeCommentsGraphNode::UpdateExistingCommentNodes(const TArray<UEdGraphNode_Comment*>* OldParentComments, const TArray<UObject*>* OldCommentContains)
+FASCNestingChanges SAutoSizeCommentsGraphNode::UpdateExistingCommentNodes(const TArray<UEdGraphNode_Comment*>* OldParentComments, const TArray<UObject*>* OldCommentContains)
 {
 	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("SAutoSizeCommentsGraphNode::UpdateExistingCommentNodes"), STAT_ASC_UpdateExistingCommentNodes, STATGROUP_AutoSizeComments);
 
+	using namespace ASCNestingInference;
+
 	// Get list of all other comment nodes
 	TSet<TSharedPtr<SAutoSizeCommentsGraphNode>> OtherCommentNodes = GetOtherCommentNodes();
 
-	TArray<UObject*> OurMainNodes = CommentNode->GetNodesUnderComment().FilterByPredicate(IsMajorNode);
+	TArray<UObject*> OurMainNodes;
+	GetSortedMajorNodes(CommentNode, OurMainNodes);
+
+	// reused for each of the other comments
+	TArray<UObject*> OtherMainNodes;
 
-	TArray<UEdGraphNode_Comment*> CurrentParentComments = GetParentComments();
+	const TArray<UEdGraphNode_Comment*> CurrentParentComments = GetParentComments();
+	const TArray<UEdGraphNode_Comment*> CurrentChildComments = GetChildComments();
+
+	const auto GatherChanges = [this, &CurrentParentComments, &CurrentChildComments]()
+	{
+		FASCNestingChanges Changes;
+		AddEdgeChanges(CommentNode, CurrentParentComments, GetParentComments(), true, Changes);
+		AddEdgeChanges(CommentNode, CurrentChildComments, GetChildComments(), false, Changes);
+		return Changes;
+	};
 
 	// Remove ourselves from our parent comments, as we will be adding ourselves later if required
 	for (UEdGraphNode_Comment* ParentComment : CurrentParentComments)
@@ -1347,23 +1560,17 @@ void SAutoSizeCommentsGraphNode::UpdateExistingCommentNodes(const TArray<UEdGrap
 
 	// Remove any comment nodes which have nodes we don't contain
 	TSet<UObject*> NodesToRemove;
-	for (UObject* Obj : CommentNode->GetNodesUnderComment())
+	for (UEdGraphNode_Comment* OtherComment : CurrentChildComments)
 	{
-		if (UEdGraphNode_Comment* OtherComment = Cast<UEdGraphNode_Comment>(Obj))
+		if (IsHeaderComment(OtherComment))
 		{
-			const auto OtherMainNodes = TSet<UObject*>(OtherComment->GetNodesUnderComment().FilterByPredicate(IsMajorNode));
-			for (UObject* OtherMain : OtherMainNodes)
-			{
-				// if we don't contain any node in the other node node, the comment should be removed
-				if (!OurMainNodes.Contains(OtherMain))
-				{
-					if (!IsHeaderComment(OtherComment))
-					{
-						NodesToRemove.Add(OtherComment);
-					}
-					break;
-				}
-			}
+			continue;
+		}
+
+		GetSortedMajorNodes(OtherComment, OtherMainNodes);
+		if (CountSharedNodes(OurMainNodes, OtherMainNodes) != OtherMainNodes.Num())
+		{
+			NodesToRemove.Add(OtherComment);
 		}
 	}
 
@@ -1372,10 +1579,9 @@ void SAutoSizeCommentsGraphNode::UpdateExistingCommentNodes(const TArray<UEdGrap
 	// Do nothing if we have no nodes under ourselves
 	if (CommentNode->GetNodesUnderComment().Num() == 0)
 	{
-		return;
+		return GatherChanges();
 	}
 
-	bool bNeedsPurging = false;
 	for (TSharedPtr<SAutoSizeCommentsGraphNode> OtherCommentNode : OtherCommentNodes)
 	{
 		UEdGraphNode_Comment* OtherComment = OtherCommentNode->GetCommentNodeObj();
@@ -1385,18 +1591,17 @@ void SAutoSizeCommentsGraphNode::UpdateExistingCommentNodes(const TArray<UEdGrap
 			continue;
 		}
 
-		const auto OtherMainNodes = OtherComment->GetNodesUnderComment().FilterByPredicate(IsMajorNode);
+		GetSortedMajorNodes(OtherComment, OtherMainNodes);
 
 		if (OtherMainNodes.Num() == 0)
 		{
 			continue;
 		}
 
+		const int32 NumSharedNodes = CountSharedNodes(OurMainNodes, OtherMainNodes);
+
 		// check if all nodes in the other comment box are within our comment box AND we are not inside the other comment already
-		const bool bAllNodesContainedUnderSelf = !OtherMainNodes.ContainsByPredicate([&OurMainNodes](UObject* NodeUnderOther)
-		{
-			return !OurMainNodes.Contains(NodeUnderOther);
-		});
+		const bool bAllNodesContainedUnderSelf = NumSharedNodes == OtherMainNodes.Num();
 
 		bool bDontAddSameSet;
 
@@ -1418,30 +1623,35 @@ void SAutoSizeCommentsGraphNode::UpdateExistingCommentNodes(const TArray<UEdGrap
 		{
 			// add the other comment into ourself
 			FASCUtils::AddNodeIntoComment(CommentNode, OtherComment);
-			bNeedsPurging = true;
 		}
-		else
+		// other comment contains all of our nodes, add ourself into the other comment
+		else if (NumSharedNodes == OurMainNodes.Num())
 		{
-			// check if all nodes in the other comment box are within our comment box
-			const bool bAllNodesContainedUnderOther = !OurMainNodes.ContainsByPredicate([&OtherMainNodes](UObject* NodeUnderSelf)
-			{
-				return !OtherMainNodes.Contains(NodeUnderSelf);
-			});
-
-			// other comment contains all of our nodes, add ourself into the other comment
-			if (bAllNodesContainedUnderOther) 
-			{
-				// add the ourselves into the other comment
-				FASCUtils::AddNodeIntoComment(OtherComment, CommentNode);
-				bNeedsPurging = true;
-			}
+			FASCUtils::AddNodeIntoComment(OtherComment, CommentNode);
 		}
 	}
 
-	if (bNeedsPurging && UAutoSizeCommentsSettings::Get().bEnableFixForSortDepthIssue)
+	FASCNestingChanges Changes = GatherChanges();
+	if (!Changes.IsEmpty() && UAutoSizeCommentsSettings::Get().bEnableFixForSortDepthIssue)
 	{
 		FAutoSizeCommentGraphHandler::Get().RequestGraphVisualRefresh(GetOwnerPanel());
 	}
+
+	return Changes;
+}
+
+TArray<UEdGraphNode_Comment*> SAutoSizeCommentsGraphNode::GetChildComments() const
+{
+	TArray<UEdGraphNode_Comment*> ChildComments;
+	for (UObject* Obj : CommentNode->GetNodesUnderComment())
+	{
+		if (UEdGraphNode_Comment* ChildComment = Cast<UEdGraphNode_Comment>(Obj))
+		{
+			ChildComments.Add(ChildComment);
+		}
+	}
+
+	return ChildComments;
 }
 
 FSlateColor SAutoSizeCommentsGraphNode::GetCommentBodyColor() const
@@ -1513,17 +1723,23 @@ FASCCommentData& SAutoSizeCommentsGraphNode::GetCommentData() const
 	return FAutoSizeCommentsCacheFile::Get().GetCommentData(CommentNode);
 }
 
-void SAutoSizeCommentsGraphNode::ResizeToFit()
+bool SAutoSizeCommentsGraphNode::ResizeToFit()
 {
-	ResizeToFit_Impl();
+	const float OldWidth = UserSize.X;
+
+	const bool bChanged = ResizeToFit_Impl();
 
-	if (UAutoSizeCommentsSettings::Get().bUseTwoPassResize && GetResizingMode() == EASCResizingMode::Reactive)
+	// the title bar height depends on the title wrapping, which is only updated for the new width on the next layout
+	if (!FMath::IsNearlyEqual(OldWidth, UserSize.X) &&
+		UAutoSizeCommentsSettings::Get().bUseTwoPassResize && GetResizingMode() == EASCResizingMode::Reactive)
 	{
 		TwoPassResizeDelay = 2;
 	}
+
+	return bChanged;
 }
 
-void SAutoSizeCommentsGraphNode::ResizeToFit_Impl()
+bool SAutoSizeCommentsGraphNode::ResizeToFit_Impl()
 {
 	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("SAutoSizeCommentsGraphNode::ResizeToFit"), STAT_ASC_ResizeToFit, STATGROUP_AutoSizeComments);
 
@@ -1549,10 +1765,12 @@ void SAutoSizeCommentsGraphNode::ResizeToFit_Impl()
 		FASCVector2 CurrSize = Bounds.GetSize();
 		CurrSize.Y += TitleBarHeight;
 
+		bool bChanged = false;
 		if (!UserSize.Equals(CurrSize, .1f))
 		{
 			UserSize = CurrSize;
 			GetNodeObj()->ResizeNode(CurrSize);
+			bChanged = true;
 		}
 
 		// check if location has changed
@@ -1564,7 +1782,16 @@ void SAutoSizeCommentsGraphNode::ResizeToFit_Impl()
 		{
 			GraphNode->NodePosX = DesiredPos.X;
 			GraphNode->NodePosY = DesiredPos.Y;
+			bChanged = true;
+		}
+
+		// our parent comments may need to resize around us
+		if (bChanged)
+		{
+			FAutoSizeCommentGraphHandler::Get().MarkContainingCommentsDirty(CommentNode);
 		}
+
+		return bChanged;
 	}
 	else
 	{
@@ -1585,6 +1812,8 @@ void SAutoSizeCommentsGraphNode::ResizeToFit_Impl()
 		{
 			GetNodeObj()->ResizeNode(UserSize);
 		}
+
+		return bEdited;
 	}
 }
 
@@ -1703,11 +1932,17 @@ void SAutoSizeCommentsGraphNode::OnTitleChanged(const FString& OldTitle, const F
 
 void SAutoSizeCommentsGraphNode::MoveEmptyCommentBoxes()
 {
-	TArray<UObject*> UnderComment = CommentNode->GetNodesUnderComment();
+	// only empty comments move, check this before looking at any other comments
+	if (!UAutoSizeCommentsSettings::Get().bMoveEmptyCommentBoxes || CommentNode->GetNodesUnderComment().Num() > 0 || IsHeaderComment())
+	{
+		return;
+	}
 
 	TSharedPtr<SGraphPanel> OwnerPanel = OwnerGraphPanelPtr.Pin();
-
-	bool bIsSelected = OwnerPanel->SelectionManager.IsNodeSelected(GraphNode);
+	if (!OwnerPanel || OwnerPanel->SelectionManager.IsNodeSelected(GraphNode))
+	{
+		return;
+	}
 
 	bool bIsContained = false;
 	for (TSharedPtr<SAutoSizeCommentsGraphNode> OtherCommentNode : GetOtherCommentNodes())
@@ -1722,28 +1957,35 @@ void SAutoSizeCommentsGraphNode::MoveEmptyCommentBoxes()
 	}
 
 	// if the comment node is empty, move away from other comment nodes
-	if (UnderComment.Num() == 0 && UAutoSizeCommentsSettings::Get().bMoveEmptyCommentBoxes && !bIsSelected && !bIsContained && !IsHeaderComment())
+	if (!bIsContained)
 	{
 		FASCVector2 TotalMovement(0, 0);
 
 		bool bAnyCollision = false;
 
-		for (TSharedPtr<SAutoSizeCommentsGraphNode> OtherCommentNode : GetOtherCommentNodes())
+		const FSlateRect MyBounds = FASCNodeSpatialIndex::GetNodeWidgetRect(*this);
+
+		// only look at the comments near us
+		TArray<UEdGraphNode_Comment*> OverlappingComments;
+		FAutoSizeCommentGraphHandler::Get().GetSpatialIndex(OwnerPanel).QueryComments(MyBounds, OverlappingComments);
+
+		for (UEdGraphNode_Comment* OtherComment : OverlappingComments)
 		{
-			if (OtherCommentNode->IsHeaderComment())
+			if (OtherComment == CommentNode || IsHeaderComment(OtherComment))
 			{
 				continue;
 			}
 
-			UEdGraphNode_Comment* OtherComment = OtherCommentNode->GetCommentNodeObj();
-
 			if (OtherComment->GetNodesUnderComment().Contains(CommentNode))
 			{
 				continue;
 			}
 
-			FSlateRect OtherBounds = GetCommentBounds(OtherComment);
-			FSlateRect MyBounds = GetCommentBounds(CommentNode);
+			// the index rect may be from before the other comment moved this frame, so test its live widget
+			const TSharedPtr<SAutoSizeCommentsGraphNode> OtherASCComment = FASCState::Get().GetASCComment(OtherComment);
+			const FSlateRect OtherBounds = OtherASCComment
+				? FASCNodeSpatialIndex::GetNodeWidgetRect(*OtherASCComment)
+				: GetCommentBounds(OtherComment);
 
 			if (FSlateRect::DoRectanglesIntersect(OtherBounds, MyBounds))
 			{
@@ -1779,6 +2021,12 @@ void SAutoSizeCommentsGraphNode::MoveEmptyCommentBoxes()
 
 		GraphNode->NodePosX += TotalMovement.X;
 		GraphNode->NodePosY += TotalMovement.Y;
+
+		// keep moving next tick until we are no longer colliding, the move also changes any comment containing us
+		if (bAnyCollision)
+		{
+			FAutoSizeCommentGraphHandler::Get().MarkContainingCommentsDirty(CommentNode);
+		}
 	}
 }
 
@@ -2025,20 +2273,9 @@ TSet<TSharedPtr<SAutoSizeCommentsGraphNode>> SAutoSizeCommentsGraphNode::GetOthe
 TArray<UEdGraphNode_Comment*> SAutoSizeCommentsGraphNode::GetParentComments() const
 {
 	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("SAutoSizeCommentsGraphNode::GetParentComments"), STAT_ASC_GetParentComments, STATGROUP_AutoSizeComments);
-	TArray<UEdGraphNode_Comment*> ParentComments;
 
-	for (UEdGraphNode* OtherNode : CommentNode->GetGraph()->Nodes)
-	{
-		if (auto OtherComment = Cast<UEdGraphNode_Comment>(OtherNode))
-		{
-			if (OtherComment != CommentNode && OtherComment->GetNodesUnderComment().Contains(CommentNode))
-			{
-				ParentComments.Add(OtherComment);
-			}
-		}
-	}
-
-	return ParentComments;
+	// the containment index mirrors the live nodes under each comment, which is what this used to scan
+	return FAutoSizeCommentGraphHandler::Get().GetContainingComments(CommentNode);
 }
 
 FSlateRect SAutoSizeCommentsGraphNode::GetCommentBounds(UEdGraphNode_Comment* InCommentNode)
@@ -2154,7 +2391,11 @@ void SAutoSizeCommentsGraphNode::SetIsHeader(bool bNewValue, bool bUpdateStyle)
 
 	// update the comment data
 	FASCCommentData& CommentData = GetCommentData();
-	CommentData.SetHeader(bNewValue);
+	if (CommentData.IsHeader() != bNewValue)
+	{
+		CommentData.SetHeader(bNewValue);
+		FAutoSizeCommentsCacheFile::Get().MarkCommentDirty(CommentNode);
+	}
 
 	if (bIsHeader) // apply header style
 	{
@@ -2237,36 +2478,18 @@ bool SAutoSizeCommentsGraphNode::IsNodeUnrelated() const
 
 void SAutoSizeCommentsGraphNode::SetNodesRelated(const TArray<UEdGraphNode*>& Nodes, bool bIncludeSelf)
 {
-#if ASC_UE_VERSION_OR_LATER(4, 23)
-	const TArray<UEdGraphNode*>& AllNodes = GetNodeObj()->GetGraph()->Nodes;
-	for (UEdGraphNode* Node : AllNodes)
-	{
-		Node->SetNodeUnrelated(true);
-	}
-
+	TSet<UEdGraphNode*> RelatedNodes(Nodes);
 	if (bIncludeSelf)
 	{
-		GetCommentNodeObj()->SetNodeUnrelated(false);
+		RelatedNodes.Add(GetCommentNodeObj());
 	}
 
-	for (UEdGraphNode* Node : Nodes)
-	{
-		Node->SetNodeUnrelated(false);
-	}
-#endif
+	FAutoSizeCommentGraphHandler::Get().SetNodesRelated(GetNodeObj()->GetGraph(), RelatedNodes);
 }
 
 void SAutoSizeCommentsGraphNode::ResetNodesUnrelated()
 {
-#if ASC_UE_VERSION_OR_LATER(4, 23)
-	if (UEdGraph* Graph = GetNodeObj()->GetGraph())
-	{
-		for (UEdGraphNode* Node : Graph->Nodes)
-		{
-			Node->SetNodeUnrelated(false);
-		}
-	}
-#endif
+	FAutoSizeCommentGraphHandler::Get().ResetNodesUnrelated(GetNodeObj()->GetGraph());
 }
 
 bool SAutoSizeCommentsGraphNode::IsExistingComment() const
@@ -2321,28 +2544,26 @@ bool SAutoSizeCommentsGraphNode::IsPresetStyle()
 
 bool SAutoSizeCommentsGraphNode::LoadCache()
 {
-	CommentNode->ClearNodesUnderComment();
+	FASCCommentNodesEdit Edit(CommentNode);
+	Edit.Clear();
 
 	TArray<UEdGraphNode*> OutNodesUnder;
-	if (FAutoSizeCommentsCacheFile::Get().GetNodesUnderComment(SharedThis(this), OutNodesUnder))
+	const bool bFoundCache = FAutoSizeCommentsCacheFile::Get().GetNodesUnderComment(SharedThis(this), OutNodesUnder);
+	for (UEdGraphNode* Node : OutNodesUnder)
 	{
-		for (UEdGraphNode* Node : OutNodesUnder)
+		if (!HasNodeBeenDeleted(Node))
 		{
-			if (!HasNodeBeenDeleted(Node))
-			{
-				FASCUtils::AddNodeIntoComment(CommentNode, Node, false);
-			}
+			Edit.Add(Node);
 		}
-
-		return true;
 	}
 
-	return false;
+	Edit.Commit(false);
+	return bFoundCache;
 }
 
 void SAutoSizeCommentsGraphNode::UpdateCache()
 {
-	GetCommentData().UpdateNodesUnderComment(CommentNode);
+	FAutoSizeCommentsCacheFile::Get().UpdateNodesUnderComment(CommentNode);
 }
 
 void SAutoSizeCommentsGraphNode::QueryNodesUnderComment(TArray<UEdGraphNode*>& OutNodesUnderComment, const ECommentCollisionMethod OverrideCollisionMethod, const bool bIgnoreKnots)
@@ -2363,57 +2584,40 @@ void SAutoSizeCommentsGraphNode::QueryNodesUnderComment(TArray<TSharedPtr<SGraph
 	}
 
 	TSharedPtr<SGraphPanel> OwnerPanel = GetOwnerPanel();
+	if (!OwnerPanel)
+	{
+		return;
+	}
 
-	float TitleBarHeight = GetTitleBarHeight();
-
-	const FASCVector2 NodeSize(UserSize.X, UserSize.Y - TitleBarHeight);
-
-	// Get our geometry
-	FASCVector2 NodePosition = GetPos();
-	NodePosition.Y += TitleBarHeight;
-
-	const FSlateRect CommentRect = FSlateRect::FromPointAndExtent(NodePosition, NodeSize).ExtendBy(1);
+	const FSlateRect CommentRect = GetCommentCollisionRect();
 
-	FChildren* PanelChildren = OwnerPanel->GetAllChildren();
-	int32 NumChildren = PanelChildren->Num();
+	// only test the nodes near our comment
+	TArray<TSharedRef<SGraphNode>> CollidingNodes;
+	FAutoSizeCommentGraphHandler::Get().GetSpatialIndex(OwnerPanel).QueryNodes(CommentRect, OverrideCollisionMethod, CollidingNodes);
 
-	// Iterate across all nodes in the graph
-	for (int32 NodeIndex = 0; NodeIndex < NumChildren; ++NodeIndex)
+	for (const TSharedRef<SGraphNode>& SomeNodeWidget : CollidingNodes)
 	{
-		const TSharedRef<SGraphNode> SomeNodeWidget = StaticCastSharedRef<SGraphNode>(PanelChildren->GetChildAt(NodeIndex));
-
 		UObject* GraphObject = SomeNodeWidget->GetObjectBeingDisplayed();
 		if (GraphObject == nullptr || GraphObject == CommentNode)
 		{
 			continue;
 		}
 
-		// check if the node bounds collides with our bounds
-		const FASCVector2 SomeNodePosition = FASCUtils::GetNodePos(&SomeNodeWidget.Get());
-		const FASCVector2 SomeNodeSize = SomeNodeWidget->GetDesiredSize();
-		const FSlateRect NodeGeometryGraphSpace = FSlateRect::FromPointAndExtent(SomeNodePosition, SomeNodeSize);
+		OutNodesUnderComment.Add(SomeNodeWidget);
+	}
+}
 
-		bool bIsOverlapping = false;
+FSlateRect SAutoSizeCommentsGraphNode::GetCommentCollisionRect() const
+{
+	const float TitleBarHeight = GetTitleBarHeight();
 
-		switch (OverrideCollisionMethod)
-		{
-			case ECommentCollisionMethod::Point:
-				bIsOverlapping = CommentRect.ContainsPoint(SomeNodePosition);
-				break;
-			case ECommentCollisionMethod::Intersect:
-				CommentRect.IntersectionWith(NodeGeometryGraphSpace, bIsOverlapping);
-				break;
-			case ECommentCollisionMethod::Contained:
-				bIsOverlapping = FSlateRect::IsRectangleContained(CommentRect, NodeGeometryGraphSpace);
-				break;
-			default: ;
-		}
+	const FASCVector2 NodeSize(UserSize.X, UserSize.Y - TitleBarHeight);
 
-		if (bIsOverlapping)
-		{
-			OutNodesUnderComment.Add(SomeNodeWidget);
-		}
-	}
+	// Get our geometry
+	FASCVector2 NodePosition = GetPos();
+	NodePosition.Y += TitleBarHeight;
+
+	return FSlateRect::FromPointAndExtent(NodePosition, NodeSize).ExtendBy(1);
 }
 
 void SAutoSizeCommentsGraphNode::RandomizeColor()
@@ -2443,12 +2647,12 @@ void SAutoSizeCommentsGraphNode::AdjustMinSize(FASCVector2& InSize)
 
 bool SAutoSizeCommentsGraphNode::HasNodeBeenDeleted(UEdGraphNode* Node)
 {
-	if (Node == nullptr)
+	if (Node == nullptr || Node->GetGraph() != CommentNode->GetGraph())
 	{
 		return true;
 	}
 
-	return !CommentNode->GetGraph()->Nodes.Contains(Node);
+	return FASCUtils::HasNodeBeenDeleted(Node);
 }
 
 bool SAutoSizeCommentsGraphNode::CanAddNode(const TSharedPtr<SGraphNode> OtherGraphNode, const bool bIgnoreKnots) const
@@ -2524,7 +2728,31 @@ FSlateRect SAutoSizeCommentsGraphNode::GetNodeBounds(UEdGraphNode* Node)
 	FASCVector2 Pos(Node->NodePosX, Node->NodePosY);
 	FASCVector2 Size(300, 150);
 
-	TSharedPtr<SGraphNode> LocalGraphNode = FASCUtils::GetGraphNode(GetOwnerPanel(), Node);
+	TSharedPtr<SGraphPanel> OwnerPanel = GetOwnerPanel();
+
+	const bool bUseCommentBubble = UAutoSizeCommentsSettings::Get().bUseCommentBubbleBounds && Node->bCommentBubbleVisible;
+
+	// comments may have been resized earlier this frame, their widget only picks up the new size on the next layout
+	if (!bUseCommentBubble)
+	{
+		if (UEdGraphNode_Comment* OtherComment = Cast<UEdGraphNode_Comment>(Node))
+		{
+			return GetCommentBounds(OtherComment);
+		}
+	}
+
+	// the spatial index already stores the widget rect, we only need the widget for the comment bubble
+	if (OwnerPanel && !bUseCommentBubble)
+	{
+		FSlateRect CachedRect;
+		if (FAutoSizeCommentGraphHandler::Get().GetSpatialIndex(OwnerPanel).FindNodeRect(Node->NodeGuid, CachedRect) &&
+			CachedRect.Left == Pos.X && CachedRect.Top == Pos.Y)
+		{
+			return CachedRect;
+		}
+	}
+
+	TSharedPtr<SGraphNode> LocalGraphNode = FASCUtils::GetGraphNode(OwnerPanel, Node);
 	if (LocalGraphNode.IsValid())
 	{
 		Pos = FASCUtils::GetNodePos(LocalGraphNode.Get());
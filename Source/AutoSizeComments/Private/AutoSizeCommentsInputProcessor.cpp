@@ -3,6 +3,7 @@
 #include "AutoSizeCommentsInputProcessor.h"
 
 #include "AutoSizeCommentsCommands.h"
+#include "AutoSizeCommentsGraphHandler.h"
 #include "AutoSizeCommentsSettings.h"
 #include "AutoSizeCommentsUtils.h"
 #include "SGraphPanel.h"
@@ -43,6 +44,8 @@ FAutoSizeCommentsInputProcessor& FAutoSizeCommentsInputProcessor::Get()
 
 bool FAutoSizeCommentsInputProcessor::HandleMouseButtonDownEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent)
 {
+	FAutoSizeCommentGraphHandler::Get().MarkSelectionDirty();
+
 	if (UAutoSizeCommentsSettings::Get().bSelectNodeWhenClickingOnPin)
 	{
 		// this logic is required for the auto insert comment to work correctly
@@ -81,9 +84,17 @@ bool FAutoSizeCommentsInputProcessor::HandleMouseButtonDownEvent(FSlateApplicati
 	return false;
 }
 
+bool FAutoSizeCommentsInputProcessor::HandleMouseButtonUpEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent)
+{
+	// e.g. marquee selection finishes on mouse up
+	FAutoSizeCommentGraphHandler::Get().MarkSelectionDirty();
+	return false;
+}
+
 bool FAutoSizeCommentsInputProcessor::HandleKeyDownEvent(FSlateApplication& SlateApp, const FKeyEvent& KeyEvent)
 {
 	KeysDown.Add(KeyEvent.GetKey());
+	FAutoSizeCommentGraphHandler::Get().MarkSelectionDirty();
 
 	if (FSlateApplication::Get().IsDragDropping())
 	{
@@ -4,6 +4,7 @@
 
 #include "AutoSizeCommentsCacheFile.h"
 #include "AutoSizeCommentsCommands.h"
+#include "AutoSizeCommentsDeferredWork.h"
 #include "AutoSizeCommentsGraphHandler.h"
 #include "AutoSizeCommentsGraphPanelNodeFactory.h"
 #include "AutoSizeCommentsInputProcessor.h"
@@ -96,6 +97,8 @@ void FAutoSizeCommentsModule::ShutdownModule()
 
 	FAutoSizeCommentsCacheFile::Get().Cleanup();
 
+	FASCDeferredWork::Get().Cleanup();
+
 	FASCStyle::Shutdown();
 
 	FASCCommands::Unregister();
@@ -2,11 +2,37 @@
 
 #include "AutoSizeCommentsNodeChangeData.h"
 
+#include "AutoSizeCommentsGraphNode.h"
 #include "AutoSizeCommentsModule.h"
+#include "AutoSizeCommentsSettings.h"
 #include "AutoSizeCommentsUtils.h"
+#include "CoreGlobals.h"
 #include "EdGraphNode_Comment.h"
 #include "EdGraphSchema_K2.h"
 #include "K2Node_CreateDelegate.h"
+#include "Hash/CityHash.h"
+
+struct FASCHashBuilder
+{
+	uint64 Hash = 0;
+
+	void AddInt(uint64 Value)
+	{
+		Hash = CityHash128to64(Uint128_64(Hash, Value));
+	}
+
+	void AddString(const FString& String)
+	{
+		AddInt(String.Len());
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(*String), String.Len() * sizeof(TCHAR), Hash);
+	}
+
+	void AddGuid(const FGuid& Guid)
+	{
+		AddInt((static_cast<uint64>(Guid.A) << 32) | Guid.B);
+		AddInt((static_cast<uint64>(Guid.C) << 32) | Guid.D);
+	}
+};
 
 void FASCPinChangeData::UpdatePin(UEdGraphPin* Pin)
 {
@@ -77,7 +103,7 @@ FText FASCPinChangeData::GetPinLabel(UEdGraphPin* Pin) const
 	return FText::GetEmpty();
 }
 
-void FASCNodeChangeData::UpdateNode(UEdGraphNode* Node)
+void FASCNodeChangeDebugData::UpdateNode(UEdGraphNode* Node)
 {
 	PinChangeData.Reset();
 	for (UEdGraphPin* Pin : Node->GetAllPins())
@@ -98,11 +124,13 @@ void FASCNodeChangeData::UpdateNode(UEdGraphNode* Node)
 	}
 }
 
-bool FASCNodeChangeData::HasNodeChanged(UEdGraphNode* Node)
+void FASCNodeChangeDebugData::LogChanges(UEdGraphNode* Node)
 {
+	const FString NodeName = FASCUtils::GetNodeName(Node);
+
 	if (Node->NodePosX != NodeX || Node->NodePosY != NodeY)
 	{
-		return true;
+		UE_LOG(LogAutoSizeComments, Log, TEXT("%s: position changed"), *NodeName);
 	}
 
 	TArray<FGuid> PinGuids;
@@ -114,69 +142,181 @@ bool FASCNodeChangeData::HasNodeChanged(UEdGraphNode* Node)
 		{
 			if (FoundPinData->HasPinChanged(Pin))
 			{
-				return true;
+				UE_LOG(LogAutoSizeComments, Log, TEXT("%s: pin %s changed"), *NodeName, *Pin->PinName.ToString());
 			}
 
 			PinGuids.Remove(Pin->PinId);
 		}
-		else // added a new pin
+		else
 		{
-			return true;
+			UE_LOG(LogAutoSizeComments, Log, TEXT("%s: pin %s added"), *NodeName, *Pin->PinName.ToString());
 		}
 	}
 
-	// If there are remaining pins, then they must have been removed
 	if (PinGuids.Num())
 	{
-		return true;
+		UE_LOG(LogAutoSizeComments, Log, TEXT("%s: %d pins removed"), *NodeName, PinGuids.Num());
 	}
 
 	if (AdvancedPinDisplay != (Node->AdvancedPinDisplay == ENodeAdvancedPins::Shown))
 	{
-		return true;
+		UE_LOG(LogAutoSizeComments, Log, TEXT("%s: advanced pin display changed"), *NodeName);
 	}
 
 	if (NodeTitle != Node->GetNodeTitle(ENodeTitleType::FullTitle).ToString())
 	{
-		return true;
+		UE_LOG(LogAutoSizeComments, Log, TEXT("%s: title changed"), *NodeName);
 	}
 
 	if (bCommentBubblePinned != Node->bCommentBubblePinned)
 	{
-		return true;
+		UE_LOG(LogAutoSizeComments, Log, TEXT("%s: comment bubble pinned changed"), *NodeName);
 	}
 
 	if (NodeEnabledState != Node->GetDesiredEnabledState())
 	{
-		return true;
+		UE_LOG(LogAutoSizeComments, Log, TEXT("%s: enabled state changed"), *NodeName);
 	}
 
 	if (UK2Node_CreateDelegate* Delegate = Cast<UK2Node_CreateDelegate>(Node))
 	{
 		if (DelegateFunctionName != Delegate->GetFunctionName())
 		{
-			return true;
+			UE_LOG(LogAutoSizeComments, Log, TEXT("%s: delegate function changed"), *NodeName);
 		}
 	}
+}
 
-	return false;
+uint64 FASCNodeChangeData::GetNodeHash(UEdGraphNode* Node, uint32 Generation)
+{
+	if (HashGeneration != Generation)
+	{
+		HashGeneration = Generation;
+		NodeHash = CalculateNodeHash(Node);
+	}
+
+	// record the node as soon as the setting is enabled (not only on the first hash) so the next change is logged
+	if (!UAutoSizeCommentsSettings::Get().bDebugNodeChanges)
+	{
+		DebugData.Reset();
+	}
+	else if (!DebugData)
+	{
+		DebugData = MakeShared<FASCNodeChangeDebugData>();
+		DebugData->UpdateNode(Node);
+	}
+
+	return NodeHash;
 }
 
-void FASCCommentChangeData::UpdateComment(UEdGraphNode_Comment* Comment)
+void FASCNodeChangeData::LogChanges(UEdGraphNode* Node)
 {
-	NodeChangeData.Reset();
+	if (DebugData)
+	{
+		DebugData->LogChanges(Node);
+		DebugData->UpdateNode(Node);
+	}
+}
+
+uint64 FASCNodeChangeData::CalculateNodeHash(UEdGraphNode* Node)
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCNodeChangeData::CalculateNodeHash"), STAT_ASC_CalculateNodeHash, STATGROUP_AutoSizeComments);
+
+	// only hash stable fields which are cheap to read, formatting titles and pin names for every node is too slow
+	FASCHashBuilder Builder;
+	Builder.AddInt(static_cast<uint32>(Node->NodePosX));
+	Builder.AddInt(static_cast<uint32>(Node->NodePosY));
+	Builder.AddInt(static_cast<uint32>(Node->NodeWidth));
+	Builder.AddInt(static_cast<uint32>(Node->NodeHeight));
+
+	Builder.AddInt(Node->Pins.Num());
+	for (UEdGraphPin* Pin : Node->Pins)
+	{
+		Builder.AddGuid(Pin->PinId);
+		Builder.AddInt(GetTypeHash(Pin->PinName));
+		Builder.AddInt(GetTypeHash(Pin->PinType.PinCategory));
+		Builder.AddInt(GetTypeHash(Pin->PinType.PinSubCategory));
+		Builder.AddInt(GetTypeHash(Pin->PinType.PinSubCategoryObject));
+		Builder.AddInt(static_cast<uint32>(Pin->PinType.ContainerType));
+		Builder.AddInt(Pin->bHidden);
+
+		// these pins do not change size
+		Builder.AddInt(Pin->PinType.PinSubCategory != UEdGraphSchema_K2::PC_Exec ? Pin->LinkedTo.Num() : 0);
+
+		Builder.AddString(Pin->DefaultValue);
+		Builder.AddString(Pin->DefaultTextValue.ToString());
+		Builder.AddInt(Pin->DefaultObject ? GetTypeHash(Pin->DefaultObject->GetFName()) : 0);
+	}
+
+	Builder.AddInt(Node->AdvancedPinDisplay == ENodeAdvancedPins::Shown);
+	Builder.AddString(Node->NodeComment);
+	Builder.AddInt(Node->bCommentBubblePinned);
+	Builder.AddInt(static_cast<uint64>(Node->GetDesiredEnabledState()));
+
+	if (UK2Node_CreateDelegate* Delegate = Cast<UK2Node_CreateDelegate>(Node))
+	{
+		Builder.AddInt(GetTypeHash(Delegate->GetFunctionName()));
+	}
+
+	return Builder.Hash;
+}
+
+uint64 FASCNodeChangeCache::GetNodeHash(UEdGraphNode* Node)
+{
+	return NodeChangeData.FindOrAdd(Node).GetNodeHash(Node, Generation);
+}
+
+void FASCNodeChangeCache::Invalidate(UEdGraphNode* Node)
+{
+	if (FASCNodeChangeData* Data = NodeChangeData.Find(Node))
+	{
+		Data->Invalidate();
+	}
+}
+
+void FASCNodeChangeCache::InvalidateAll()
+{
+	// 0 is reserved for invalidated data
+	if (++Generation == 0)
+	{
+		Generation = 1;
+	}
+}
+
+void FASCNodeChangeCache::LogChanges(UEdGraphNode* Node)
+{
+	if (FASCNodeChangeData* Data = NodeChangeData.Find(Node))
+	{
+		Data->LogChanges(Node);
+	}
+}
+
+void FASCNodeChangeCache::RemoveStaleNodes()
+{
+	for (auto It = NodeChangeData.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FASCCommentChangeData::UpdateComment(UEdGraphNode_Comment* Comment, FASCNodeChangeCache& NodeChangeCache)
+{
+	NodeHashes.Reset();
 	for (UObject* Obj : Comment->GetNodesUnderComment())
 	{
 		if (UEdGraphNode* Node = Cast<UEdGraphNode>(Obj))
 		{
-			NodeChangeData.FindOrAdd(Node).UpdateNode(Node);
+			NodeHashes.Add(Node, NodeChangeCache.GetNodeHash(Node));
 		}
 	}
 
 	NodeComment = Comment->NodeComment;
 }
 
-bool FASCCommentChangeData::HasCommentChanged(UEdGraphNode_Comment* Comment)
+bool FASCCommentChangeData::HasCommentChanged(UEdGraphNode_Comment* Comment, FASCNodeChangeCache& NodeChangeCache)
 {
 	if (!Comment)
 	{
@@ -195,13 +335,13 @@ bool FASCCommentChangeData::HasCommentChanged(UEdGraphNode_Comment* Comment)
 	}
 
 	TArray<TWeakObjectPtr<UEdGraphNode>> LastNodes;
-	NodeChangeData.GetKeys(LastNodes);
+	NodeHashes.GetKeys(LastNodes);
 
 	// remove all deleted / invalid nodes
 	for (int i = LastNodes.Num() - 1; i >= 0; --i)
 	{
 		TWeakObjectPtr<UEdGraphNode> Node = LastNodes[i];
-		if (!Node.IsValid() || !Graph->Nodes.Contains(Node))
+		if (!Node.IsValid() || FASCUtils::HasNodeBeenDeleted(Node.Get()))
 		{
 			// UE_LOG(LogTemp, Warning, TEXT("Node deleted"));
 			LastNodes.RemoveAt(i);
@@ -217,7 +357,7 @@ bool FASCCommentChangeData::HasCommentChanged(UEdGraphNode_Comment* Comment)
 
 	for (UObject* Node : Comment->GetNodesUnderComment())
 	{
-		if (!LastNodes.Contains(Node))
+		if (!NodeHashes.Contains(Cast<UEdGraphNode>(Node)))
 		{
 			// UE_LOG(LogTemp, Warning, TEXT("Node added"));
 			return true;
@@ -228,10 +368,11 @@ bool FASCCommentChangeData::HasCommentChanged(UEdGraphNode_Comment* Comment)
 	{
 		if (Node.IsValid())
 		{
-			FASCNodeChangeData* Data = NodeChangeData.Find(Node);
-			if (Data && Data->HasNodeChanged(Node.Get()))
+			const uint64* LastHash = NodeHashes.Find(Node);
+			if (LastHash && *LastHash != NodeChangeCache.GetNodeHash(Node.Get()))
 			{
 				// UE_LOG(LogTemp, Warning, TEXT("Data has changed!"));
+				NodeChangeCache.LogChanges(Node.Get());
 				return true;
 			}
 		}
@@ -240,10 +381,18 @@ bool FASCCommentChangeData::HasCommentChanged(UEdGraphNode_Comment* Comment)
 	return false;
 }
 
+void FASCCommentChangeData::InvalidateNodes(FASCNodeChangeCache& NodeChangeCache)
+{
+	for (const auto& Elem : NodeHashes)
+	{
+		NodeChangeCache.Invalidate(Elem.Key.Get());
+	}
+}
+
 void FASCCommentChangeData::DebugPrint()
 {
 	UE_LOG(LogAutoSizeComments, Log, TEXT("%s"), *NodeComment);
-	for (auto& Elem : NodeChangeData)
+	for (auto& Elem : NodeHashes)
 	{
 		if (Elem.Key.IsValid())
 		{
@@ -16,6 +16,8 @@ UAutoSizeCommentsSettings::UAutoSizeCommentsSettings(const FObjectInitializer& O
 	Super(ObjectInitializer)
 {
 	ResizingMode = EASCResizingMode::Reactive;
+	ResizeQueueBudgetMs = 4.0f;
+	ChangePollInterval = 2.0f;
 	ResizeToFitWhenDisabled = false;
 	bUseTwoPassResize = true;
 	AutoInsertComment = EASCAutoInsertComment::Always;
@@ -45,12 +47,17 @@ UAutoSizeCommentsSettings::UAutoSizeCommentsSettings(const FObjectInitializer& O
 	bUseCommentBubbleBounds = true;
 	bMoveEmptyCommentBoxes = false;
 	EmptyCommentBoxSpeed = 10;
+	SpatialIndexMethod = EASCSpatialIndexMethod::BoundsTree;
 	bHideCommentBubble = false;
 	bEnableCommentBubbleDefaults = false;
 	bDefaultColorCommentBubble = false;
 	bDefaultShowBubbleWhenZoomed = true;
 	CacheSaveMethod = EASCCacheSaveMethod::MetaData;
 	CacheSaveLocation = EASCCacheSaveLocation::Project;
+	CacheFileFormat = EASCCacheFileFormat::Binary;
+	bSplitCacheFilePerPackage = true;
+	bUseCacheJournal = true;
+	CacheJournalCompactSize = 256;
 	bSaveCommentDataOnSavingGraph = true;
 	bSaveCommentDataOnExit = false;
 	bPrettyPrintCommentCacheJSON = false;
@@ -86,6 +93,7 @@ UAutoSizeCommentsSettings::UAutoSizeCommentsSettings(const FObjectInitializer& O
 
 	bDebugGraph_ASC = false;
 	bDisablePackageCleanup = false;
+	bDebugNodeChanges = false;
 	bDisableASCGraphNode = false;
 }
 
@@ -100,6 +108,10 @@ void UAutoSizeCommentsSettings::PostEditChangeProperty(FPropertyChangedEvent& Pr
 			FAutoSizeCommentGraphHandler::Get().ClearUnrelatedNodes();
 		}
 	}
+	else if (PropertyName == GET_MEMBER_NAME_CHECKED(UAutoSizeCommentsSettings, bSplitCacheFilePerPackage))
+	{
+		FAutoSizeCommentsCacheFile::Get().SyncSplitCacheFileMode();
+	}
 
 	Super::PostEditChangeProperty(PropertyChangedEvent);
 }
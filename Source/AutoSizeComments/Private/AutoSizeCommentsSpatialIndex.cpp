@@ -0,0 +1,1117 @@
+// Copyright fpwong. All Rights Reserved.
+
+#include "AutoSizeCommentsSpatialIndex.h"
+
+#include "AutoSizeCommentsGraphNode.h"
+#include "AutoSizeCommentsSettings.h"
+#include "AutoSizeCommentsUtils.h"
+#include "EdGraphNode_Comment.h"
+#include "SGraphPanel.h"
+
+void FASCSpatialHash::Reset()
+{
+	Cells.Reset();
+}
+
+void FASCSpatialHash::Insert(int32 Id, const FSlateRect& Rect)
+{
+	FIntPoint Min, Max;
+	GetCellRange(Rect, Min, Max);
+
+	for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+	{
+		for (int32 X = Min.X; X <= Max.X; ++X)
+		{
+			Cells.FindOrAdd(FIntPoint(X, Y)).Add(Id);
+		}
+	}
+}
+
+void FASCSpatialHash::Remove(int32 Id, const FSlateRect& Rect)
+{
+	FIntPoint Min, Max;
+	GetCellRange(Rect, Min, Max);
+
+	for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+	{
+		for (int32 X = Min.X; X <= Max.X; ++X)
+		{
+			const FIntPoint Cell(X, Y);
+			if (TArray<int32>* CellIds = Cells.Find(Cell))
+			{
+				CellIds->RemoveSingleSwap(Id);
+				if (CellIds->Num() == 0)
+				{
+					Cells.Remove(Cell);
+				}
+			}
+		}
+	}
+}
+
+void FASCSpatialHash::Update(int32 Id, const FSlateRect& OldRect, const FSlateRect& NewRect)
+{
+	FIntPoint OldMin, OldMax, NewMin, NewMax;
+	GetCellRange(OldRect, OldMin, OldMax);
+	GetCellRange(NewRect, NewMin, NewMax);
+
+	// most moves stay inside the same cells
+	if (OldMin == NewMin && OldMax == NewMax)
+	{
+		return;
+	}
+
+	Remove(Id, OldRect);
+	Insert(Id, NewRect);
+}
+
+void FASCSpatialHash::Query(const FSlateRect& Rect, TArray<int32>& OutIds) const
+{
+	FIntPoint Min, Max;
+	GetCellRange(Rect, Min, Max);
+
+	for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+	{
+		for (int32 X = Min.X; X <= Max.X; ++X)
+		{
+			if (const TArray<int32>* CellIds = Cells.Find(FIntPoint(X, Y)))
+			{
+				OutIds.Append(*CellIds);
+			}
+		}
+	}
+}
+
+int64 FASCSpatialHash::GetNumCells(const FSlateRect& Rect) const
+{
+	FIntPoint Min, Max;
+	GetCellRange(Rect, Min, Max);
+	return static_cast<int64>(Max.X - Min.X + 1) * static_cast<int64>(Max.Y - Min.Y + 1);
+}
+
+void FASCSpatialHash::GetCellRange(const FSlateRect& Rect, FIntPoint& OutMin, FIntPoint& OutMax) const
+{
+	OutMin = FIntPoint(FMath::FloorToInt(Rect.Left / CellSize), FMath::FloorToInt(Rect.Top / CellSize));
+	OutMax = FIntPoint(FMath::FloorToInt(Rect.Right / CellSize), FMath::FloorToInt(Rect.Bottom / CellSize));
+	OutMax.X = FMath::Max(OutMin.X, OutMax.X);
+	OutMax.Y = FMath::Max(OutMin.Y, OutMax.Y);
+}
+
+void FASCAABBTree::Reset()
+{
+	Nodes.Reset();
+	FreeNodes.Reset();
+	Root = INDEX_NONE;
+}
+
+int32 FASCAABBTree::Insert(int32 Id, const FSlateRect& Rect)
+{
+	const int32 Leaf = AllocateNode();
+	Nodes[Leaf].Bounds = Rect.ExtendBy(FatMargin);
+	Nodes[Leaf].Id = Id;
+	Nodes[Leaf].Height = 0;
+
+	InsertLeaf(Leaf);
+	return Leaf;
+}
+
+void FASCAABBTree::Remove(int32 ProxyId)
+{
+	RemoveLeaf(ProxyId);
+	FreeNode(ProxyId);
+}
+
+bool FASCAABBTree::Move(int32 ProxyId, const FSlateRect& NewRect)
+{
+	const FSlateRect& FatBounds = Nodes[ProxyId].Bounds;
+
+	// still inside the fattened rect and the rect has not shrunk by much, nothing to do
+	if (FSlateRect::IsRectangleContained(FatBounds, NewRect) &&
+		FSlateRect::IsRectangleContained(NewRect.ExtendBy(FatMargin * 4), FatBounds))
+	{
+		return false;
+	}
+
+	RemoveLeaf(ProxyId);
+	Nodes[ProxyId].Bounds = NewRect.ExtendBy(FatMargin);
+	InsertLeaf(ProxyId);
+	return true;
+}
+
+void FASCAABBTree::Query(const FSlateRect& Rect, TArray<int32>& OutIds) const
+{
+	if (Root == INDEX_NONE)
+	{
+		return;
+	}
+
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Add(Root);
+
+	while (Stack.Num() > 0)
+	{
+		const FTreeNode& TreeNode = Nodes[Stack.Pop()];
+		if (!FSlateRect::DoRectanglesIntersect(TreeNode.Bounds, Rect))
+		{
+			continue;
+		}
+
+		if (TreeNode.IsLeaf())
+		{
+			OutIds.Add(TreeNode.Id);
+		}
+		else
+		{
+			Stack.Add(TreeNode.Child1);
+			Stack.Add(TreeNode.Child2);
+		}
+	}
+}
+
+int32 FASCAABBTree::GetHeight() const
+{
+	return Root == INDEX_NONE ? 0 : Nodes[Root].Height;
+}
+
+int32 FASCAABBTree::AllocateNode()
+{
+	const int32 NodeIndex = FreeNodes.Num() > 0 ? FreeNodes.Pop() : Nodes.AddDefaulted();
+	Nodes[NodeIndex] = FTreeNode();
+	return NodeIndex;
+}
+
+void FASCAABBTree::FreeNode(int32 NodeIndex)
+{
+	Nodes[NodeIndex] = FTreeNode();
+	Nodes[NodeIndex].Height = INDEX_NONE;
+	FreeNodes.Add(NodeIndex);
+}
+
+void FASCAABBTree::InsertLeaf(int32 Leaf)
+{
+	if (Root == INDEX_NONE)
+	{
+		Root = Leaf;
+		Nodes[Root].Parent = INDEX_NONE;
+		return;
+	}
+
+	// find the cheapest sibling for the leaf by the increase in perimeter
+	const FSlateRect LeafBounds = Nodes[Leaf].Bounds;
+	int32 NodeIndex = Root;
+	while (!Nodes[NodeIndex].IsLeaf())
+	{
+		const FTreeNode& TreeNode = Nodes[NodeIndex];
+
+		const float Perimeter = GetPerimeter(TreeNode.Bounds);
+		const float CombinedPerimeter = GetPerimeter(Union(TreeNode.Bounds, LeafBounds));
+
+		// cost of creating a new parent for this node and the leaf
+		const float Cost = 2.0f * CombinedPerimeter;
+
+		// minimum cost of pushing the leaf further down the tree
+		const float InheritanceCost = 2.0f * (CombinedPerimeter - Perimeter);
+
+		const auto GetDescendCost = [&](int32 ChildIndex)
+		{
+			const FTreeNode& Child = Nodes[ChildIndex];
+			const float NewPerimeter = GetPerimeter(Union(Child.Bounds, LeafBounds));
+			return (Child.IsLeaf() ? NewPerimeter : NewPerimeter - GetPerimeter(Child.Bounds)) + InheritanceCost;
+		};
+
+		const float Cost1 = GetDescendCost(TreeNode.Child1);
+		const float Cost2 = GetDescendCost(TreeNode.Child2);
+
+		if (Cost < Cost1 && Cost < Cost2)
+		{
+			break;
+		}
+
+		NodeIndex = Cost1 < Cost2 ? TreeNode.Child1 : TreeNode.Child2;
+	}
+
+	const int32 Sibling = NodeIndex;
+	const int32 OldParent = Nodes[Sibling].Parent;
+
+	// allocating may resize the array, do not hold references across this
+	const int32 NewParent = AllocateNode();
+	Nodes[NewParent].Parent = OldParent;
+	Nodes[NewParent].Bounds = Union(LeafBounds, Nodes[Sibling].Bounds);
+	Nodes[NewParent].Height = Nodes[Sibling].Height + 1;
+	Nodes[NewParent].Child1 = Sibling;
+	Nodes[NewParent].Child2 = Leaf;
+
+	if (OldParent != INDEX_NONE)
+	{
+		if (Nodes[OldParent].Child1 == Sibling)
+		{
+			Nodes[OldParent].Child1 = NewParent;
+		}
+		else
+		{
+			Nodes[OldParent].Child2 = NewParent;
+		}
+	}
+	else
+	{
+		Root = NewParent;
+	}
+
+	Nodes[Sibling].Parent = NewParent;
+	Nodes[Leaf].Parent = NewParent;
+
+	Refit(Nodes[Leaf].Parent);
+}
+
+void FASCAABBTree::RemoveLeaf(int32 Leaf)
+{
+	if (Leaf == Root)
+	{
+		Root = INDEX_NONE;
+		return;
+	}
+
+	const int32 Parent = Nodes[Leaf].Parent;
+	const int32 GrandParent = Nodes[Parent].Parent;
+	const int32 Sibling = Nodes[Parent].Child1 == Leaf ? Nodes[Parent].Child2 : Nodes[Parent].Child1;
+
+	// replace the parent with the sibling
+	if (GrandParent != INDEX_NONE)
+	{
+		if (Nodes[GrandParent].Child1 == Parent)
+		{
+			Nodes[GrandParent].Child1 = Sibling;
+		}
+		else
+		{
+			Nodes[GrandParent].Child2 = Sibling;
+		}
+
+		Nodes[Sibling].Parent = GrandParent;
+		FreeNode(Parent);
+
+		Refit(GrandParent);
+	}
+	else
+	{
+		Root = Sibling;
+		Nodes[Sibling].Parent = INDEX_NONE;
+		FreeNode(Parent);
+	}
+
+	Nodes[Leaf].Parent = INDEX_NONE;
+}
+
+void FASCAABBTree::Refit(int32 NodeIndex)
+{
+	while (NodeIndex != INDEX_NONE)
+	{
+		NodeIndex = Balance(NodeIndex);
+
+		FTreeNode& TreeNode = Nodes[NodeIndex];
+		const FTreeNode& Child1 = Nodes[TreeNode.Child1];
+		const FTreeNode& Child2 = Nodes[TreeNode.Child2];
+
+		TreeNode.Height = 1 + FMath::Max(Child1.Height, Child2.Height);
+		TreeNode.Bounds = Union(Child1.Bounds, Child2.Bounds);
+
+		NodeIndex = TreeNode.Parent;
+	}
+}
+
+int32 FASCAABBTree::Balance(int32 IndexA)
+{
+	FTreeNode& A = Nodes[IndexA];
+	if (A.IsLeaf() || A.Height < 2)
+	{
+		return IndexA;
+	}
+
+	const int32 IndexB = A.Child1;
+	const int32 IndexC = A.Child2;
+	FTreeNode& B = Nodes[IndexB];
+	FTreeNode& C = Nodes[IndexC];
+
+	const int32 BalanceFactor = C.Height - B.Height;
+
+	// rotate C up
+	if (BalanceFactor > 1)
+	{
+		const int32 IndexF = C.Child1;
+		const int32 IndexG = C.Child2;
+		FTreeNode& F = Nodes[IndexF];
+		FTreeNode& G = Nodes[IndexG];
+
+		C.Child1 = IndexA;
+		C.Parent = A.Parent;
+		A.Parent = IndexC;
+
+		if (C.Parent != INDEX_NONE)
+		{
+			if (Nodes[C.Parent].Child1 == IndexA)
+			{
+				Nodes[C.Parent].Child1 = IndexC;
+			}
+			else
+			{
+				Nodes[C.Parent].Child2 = IndexC;
+			}
+		}
+		else
+		{
+			Root = IndexC;
+		}
+
+		if (F.Height > G.Height)
+		{
+			C.Child2 = IndexF;
+			A.Child2 = IndexG;
+			G.Parent = IndexA;
+			A.Bounds = Union(B.Bounds, G.Bounds);
+			C.Bounds = Union(A.Bounds, F.Bounds);
+			A.Height = 1 + FMath::Max(B.Height, G.Height);
+			C.Height = 1 + FMath::Max(A.Height, F.Height);
+		}
+		else
+		{
+			C.Child2 = IndexG;
+			A.Child2 = IndexF;
+			F.Parent = IndexA;
+			A.Bounds = Union(B.Bounds, F.Bounds);
+			C.Bounds = Union(A.Bounds, G.Bounds);
+			A.Height = 1 + FMath::Max(B.Height, F.Height);
+			C.Height = 1 + FMath::Max(A.Height, G.Height);
+		}
+
+		return IndexC;
+	}
+
+	// rotate B up
+	if (BalanceFactor < -1)
+	{
+		const int32 IndexD = B.Child1;
+		const int32 IndexE = B.Child2;
+		FTreeNode& D = Nodes[IndexD];
+		FTreeNode& E = Nodes[IndexE];
+
+		B.Child1 = IndexA;
+		B.Parent = A.Parent;
+		A.Parent = IndexB;
+
+		if (B.Parent != INDEX_NONE)
+		{
+			if (Nodes[B.Parent].Child1 == IndexA)
+			{
+				Nodes[B.Parent].Child1 = IndexB;
+			}
+			else
+			{
+				Nodes[B.Parent].Child2 = IndexB;
+			}
+		}
+		else
+		{
+			Root = IndexB;
+		}
+
+		if (D.Height > E.Height)
+		{
+			B.Child2 = IndexD;
+			A.Child1 = IndexE;
+			E.Parent = IndexA;
+			A.Bounds = Union(C.Bounds, E.Bounds);
+			B.Bounds = Union(A.Bounds, D.Bounds);
+			A.Height = 1 + FMath::Max(C.Height, E.Height);
+			B.Height = 1 + FMath::Max(A.Height, D.Height);
+		}
+		else
+		{
+			B.Child2 = IndexE;
+			A.Child1 = IndexD;
+			D.Parent = IndexA;
+			A.Bounds = Union(C.Bounds, D.Bounds);
+			B.Bounds = Union(A.Bounds, E.Bounds);
+			A.Height = 1 + FMath::Max(C.Height, D.Height);
+			B.Height = 1 + FMath::Max(A.Height, E.Height);
+		}
+
+		return IndexB;
+	}
+
+	return IndexA;
+}
+
+FSlateRect FASCAABBTree::Union(const FSlateRect& A, const FSlateRect& B)
+{
+	return A.Expand(B);
+}
+
+float FASCAABBTree::GetPerimeter(const FSlateRect& Rect)
+{
+	return 2.0f * ((Rect.Right - Rect.Left) + (Rect.Bottom - Rect.Top));
+}
+
+void FASCRectBuffer::Reset()
+{
+	Left.Reset();
+	Top.Reset();
+	Right.Reset();
+	Bottom.Reset();
+}
+
+void FASCRectBuffer::SetRect(int32 Index, const FSlateRect& Rect)
+{
+	if (Index >= Left.Num())
+	{
+		// keep the buffer padded to the vector width, new slots start empty
+		const int32 OldNum = Left.Num();
+		const int32 NewNum = Align(Index + 1, 4);
+
+		Left.SetNumUninitialized(NewNum);
+		Top.SetNumUninitialized(NewNum);
+		Right.SetNumUninitialized(NewNum);
+		Bottom.SetNumUninitialized(NewNum);
+
+		for (int32 SlotIndex = OldNum; SlotIndex < NewNum; ++SlotIndex)
+		{
+			ClearRect(SlotIndex);
+		}
+	}
+
+	Left[Index] = Rect.Left;
+	Top[Index] = Rect.Top;
+	Right[Index] = Rect.Right;
+	Bottom[Index] = Rect.Bottom;
+}
+
+void FASCRectBuffer::ClearRect(int32 Index)
+{
+	if (Index < Left.Num())
+	{
+		Left[Index] = MAX_flt;
+		Top[Index] = MAX_flt;
+		Right[Index] = MAX_flt;
+		Bottom[Index] = MAX_flt;
+	}
+}
+
+void FASCRectBuffer::TestCollisions(const FSlateRect& CommentRect, ECommentCollisionMethod CollisionMethod, TArray<uint32>& OutMask) const
+{
+	OutMask.Reset();
+	OutMask.SetNumZeroed(FMath::DivideAndRoundUp(Num(), 32));
+
+	switch (CollisionMethod)
+	{
+		case ECommentCollisionMethod::Point:
+			TestCollisions_Impl<ECommentCollisionMethod::Point>(CommentRect, OutMask);
+			break;
+		case ECommentCollisionMethod::Intersect:
+			TestCollisions_Impl<ECommentCollisionMethod::Intersect>(CommentRect, OutMask);
+			break;
+		case ECommentCollisionMethod::Contained:
+			TestCollisions_Impl<ECommentCollisionMethod::Contained>(CommentRect, OutMask);
+			break;
+		default: ;
+	}
+}
+
+template <ECommentCollisionMethod CollisionMethod>
+void FASCRectBuffer::TestCollisions_Impl(const FSlateRect& CommentRect, TArray<uint32>& OutMask) const
+{
+	const FASCVectorRegister CommentLeft = VectorSetFloat1(CommentRect.Left);
+	const FASCVectorRegister CommentTop = VectorSetFloat1(CommentRect.Top);
+	const FASCVectorRegister CommentRight = VectorSetFloat1(CommentRect.Right);
+	const FASCVectorRegister CommentBottom = VectorSetFloat1(CommentRect.Bottom);
+
+	// matches the comparisons used by FSlateRect in FASCNodeSpatialIndex::DoesCollide
+	for (int32 Index = 0; Index < Num(); Index += 4)
+	{
+		const FASCVectorRegister NodeLeft = VectorLoadAligned(&Left[Index]);
+		const FASCVectorRegister NodeTop = VectorLoadAligned(&Top[Index]);
+
+		FASCVectorRegister Hit;
+		if (CollisionMethod == ECommentCollisionMethod::Point)
+		{
+			// the top-left corner is inside the comment
+			Hit = VectorBitwiseAnd(
+				VectorBitwiseAnd(VectorCompareGE(NodeLeft, CommentLeft), VectorCompareLE(NodeLeft, CommentRight)),
+				VectorBitwiseAnd(VectorCompareGE(NodeTop, CommentTop), VectorCompareLE(NodeTop, CommentBottom)));
+		}
+		else
+		{
+			const FASCVectorRegister NodeRight = VectorLoadAligned(&Right[Index]);
+			const FASCVectorRegister NodeBottom = VectorLoadAligned(&Bottom[Index]);
+
+			if (CollisionMethod == ECommentCollisionMethod::Intersect)
+			{
+				Hit = VectorBitwiseAnd(
+					VectorBitwiseAnd(VectorCompareLE(CommentLeft, NodeRight), VectorCompareLE(NodeLeft, CommentRight)),
+					VectorBitwiseAnd(VectorCompareLE(CommentTop, NodeBottom), VectorCompareLE(NodeTop, CommentBottom)));
+			}
+			else
+			{
+				Hit = VectorBitwiseAnd(
+					VectorBitwiseAnd(VectorCompareLE(CommentLeft, NodeLeft), VectorCompareGE(CommentRight, NodeRight)),
+					VectorBitwiseAnd(VectorCompareLE(CommentTop, NodeTop), VectorCompareGE(CommentBottom, NodeBottom)));
+			}
+		}
+
+		OutMask[Index >> 5] |= static_cast<uint32>(VectorMaskBits(Hit)) << (Index & 31);
+	}
+}
+
+void FASCNodeSpatialIndex::Refresh(TSharedPtr<SGraphPanel> GraphPanel)
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCNodeSpatialIndex::Refresh"), STAT_ASC_SpatialIndexRefresh, STATGROUP_AutoSizeComments);
+
+	if (!GraphPanel)
+	{
+		return;
+	}
+
+	// rebuild from scratch if we are now displayed by a different panel
+	if (OwnerPanel.Pin() != GraphPanel)
+	{
+		Reset();
+		OwnerPanel = GraphPanel;
+	}
+
+	const EASCSpatialIndexMethod NewMethod = UAutoSizeCommentsSettings::Get().SpatialIndexMethod;
+	if (Method != NewMethod)
+	{
+		Reset();
+		Method = NewMethod;
+	}
+
+	const int32 NumChildren = GraphPanel->GetAllChildren()->Num();
+
+	// a node was added or removed, walk the panel to find it
+	if (bDirty || LastNumChildren != NumChildren)
+	{
+		RefreshAll(GraphPanel, NumChildren);
+		return;
+	}
+
+	// revalidate the dragged nodes once per frame, with any nodes inside the dragged comments
+	if (LastRefreshFrame != GFrameCounter)
+	{
+		LastRefreshFrame = GFrameCounter;
+
+		TArray<UEdGraphNode*> NodesToCheck;
+		for (UObject* SelectedObj : GraphPanel->SelectionManager.GetSelectedNodes())
+		{
+			if (UEdGraphNode* SelectedNode = Cast<UEdGraphNode>(SelectedObj))
+			{
+				NodesToCheck.Add(SelectedNode);
+			}
+		}
+
+		for (int32 CheckIndex = 0; CheckIndex < NodesToCheck.Num(); ++CheckIndex)
+		{
+			if (UEdGraphNode_Comment* Comment = Cast<UEdGraphNode_Comment>(NodesToCheck[CheckIndex]))
+			{
+				for (UObject* Obj : Comment->GetNodesUnderComment())
+				{
+					if (UEdGraphNode* Node = Cast<UEdGraphNode>(Obj))
+					{
+						NodesToCheck.AddUnique(Node);
+					}
+				}
+			}
+		}
+
+		for (UEdGraphNode* Node : NodesToCheck)
+		{
+			MovedNodes.Add(FObjectKey(Node));
+		}
+	}
+
+	if (MovedNodes.Num() == 0)
+	{
+		return;
+	}
+
+	bool bNeedsWalk = false;
+	for (const FObjectKey& NodeKey : MovedNodes)
+	{
+		if (!RevalidateNode(NodeKey))
+		{
+			bNeedsWalk = true;
+			break;
+		}
+	}
+
+	MovedNodes.Reset();
+
+	if (bNeedsWalk)
+	{
+		RefreshAll(GraphPanel, NumChildren);
+	}
+}
+
+void FASCNodeSpatialIndex::RefreshAll(TSharedPtr<SGraphPanel> GraphPanel, int32 NumChildren)
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCNodeSpatialIndex::RefreshAll"), STAT_ASC_SpatialIndexRefreshAll, STATGROUP_AutoSizeComments);
+
+	FChildren* PanelChildren = GraphPanel->GetAllChildren();
+
+	bDirty = false;
+	LastRefreshFrame = GFrameCounter;
+	LastNumChildren = NumChildren;
+	MovedNodes.Reset();
+	++RefreshStamp;
+
+	for (int32 NodeIndex = 0; NodeIndex < NumChildren; ++NodeIndex)
+	{
+		const TSharedRef<SGraphNode> NodeWidget = StaticCastSharedRef<SGraphNode>(PanelChildren->GetChildAt(NodeIndex));
+
+		UEdGraphNode* Node = NodeWidget->GetNodeObj();
+		if (!Node || !NodeWidget->GetObjectBeingDisplayed())
+		{
+			continue;
+		}
+
+		const FSlateRect Rect = GetNodeWidgetRect(NodeWidget.Get());
+
+		if (const int32* FoundIndex = NodeToEntry.Find(FObjectKey(Node)))
+		{
+			FASCSpatialEntry& Entry = Entries[*FoundIndex];
+			Entry.Widget = NodeWidget;
+			Entry.RefreshStamp = RefreshStamp;
+
+			if (!(Entry.Rect == Rect))
+			{
+				UpdateEntryRect(*FoundIndex, Rect);
+			}
+		}
+		else
+		{
+			AddEntry(Node, NodeWidget, Rect);
+
+			// new widgets may not have their desired size until they are drawn, so check them again next refresh
+			MovedNodes.Add(FObjectKey(Node));
+		}
+	}
+
+	// remove any nodes which are no longer on the panel
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); ++EntryIndex)
+	{
+		if (Entries[EntryIndex].IsValid() && Entries[EntryIndex].RefreshStamp != RefreshStamp)
+		{
+			RemoveEntry(EntryIndex);
+		}
+	}
+}
+
+bool FASCNodeSpatialIndex::RevalidateNode(const FObjectKey& NodeKey)
+{
+	const int32* FoundIndex = NodeToEntry.Find(NodeKey);
+	if (!FoundIndex)
+	{
+		// a destroyed node has nothing to update, a live one has not been added yet
+		return NodeKey.ResolveObjectPtr() == nullptr;
+	}
+
+	const TSharedPtr<SGraphNode> NodeWidget = Entries[*FoundIndex].Widget.Pin();
+	if (!NodeWidget || !NodeWidget->GetObjectBeingDisplayed())
+	{
+		return false;
+	}
+
+	const FSlateRect Rect = GetNodeWidgetRect(*NodeWidget);
+	if (!(Entries[*FoundIndex].Rect == Rect))
+	{
+		UpdateEntryRect(*FoundIndex, Rect);
+	}
+
+	return true;
+}
+
+void FASCNodeSpatialIndex::QueryNodes(const FSlateRect& CommentRect, ECommentCollisionMethod CollisionMethod, TArray<TSharedRef<SGraphNode>>& OutNodes) const
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCNodeSpatialIndex::QueryNodes"), STAT_ASC_SpatialIndexQuery, STATGROUP_AutoSizeComments);
+
+	if (CollisionMethod == ECommentCollisionMethod::Disabled)
+	{
+		return;
+	}
+
+	const auto TestEntry = [&](const FASCSpatialEntry& Entry)
+	{
+		if (Entry.IsValid() && DoesCollide(CollisionMethod, CommentRect, Entry.Rect))
+		{
+			if (TSharedPtr<SGraphNode> NodeWidget = Entry.Widget.Pin())
+			{
+				OutNodes.Add(NodeWidget.ToSharedRef());
+			}
+		}
+	};
+
+	if (ShouldTestAllEntries(CommentRect))
+	{
+		TArray<uint32> Mask;
+		RectBuffer.TestCollisions(CommentRect, CollisionMethod, Mask);
+
+		for (int32 WordIndex = 0; WordIndex < Mask.Num(); ++WordIndex)
+		{
+			for (uint32 Bits = Mask[WordIndex]; Bits != 0; Bits &= Bits - 1)
+			{
+				const int32 EntryIndex = WordIndex * 32 + FMath::CountTrailingZeros(Bits);
+				if (TSharedPtr<SGraphNode> NodeWidget = Entries[EntryIndex].Widget.Pin())
+				{
+					OutNodes.Add(NodeWidget.ToSharedRef());
+				}
+			}
+		}
+
+		return;
+	}
+
+	TArray<int32> Candidates;
+	GatherCandidates(CommentRect, Candidates);
+
+	++QueryStamp;
+	for (int32 EntryIndex : Candidates)
+	{
+		const FASCSpatialEntry& Entry = Entries[EntryIndex];
+		if (Entry.QueryStamp == QueryStamp)
+		{
+			continue;
+		}
+
+		Entry.QueryStamp = QueryStamp;
+		TestEntry(Entry);
+	}
+}
+
+void FASCNodeSpatialIndex::SweepCollisions(const TArray<FSlateRect>& CommentRects, ECommentCollisionMethod CollisionMethod, TArray<TSet<UEdGraphNode*>>& OutNodesPerComment) const
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCNodeSpatialIndex::SweepCollisions"), STAT_ASC_SpatialIndexSweep, STATGROUP_AutoSizeComments);
+
+	OutNodesPerComment.Reset();
+	OutNodesPerComment.SetNum(CommentRects.Num());
+
+	if (CollisionMethod == ECommentCollisionMethod::Disabled)
+	{
+		return;
+	}
+
+	// only the top-left corner of the node matters for point collision
+	const bool bUsePoint = CollisionMethod == ECommentCollisionMethod::Point;
+	const auto GetEntryRight = [&](int32 EntryIndex)
+	{
+		return bUsePoint ? Entries[EntryIndex].Rect.Left : Entries[EntryIndex].Rect.Right;
+	};
+
+	TArray<int32> SortedEntries;
+	SortedEntries.Reserve(Entries.Num());
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); ++EntryIndex)
+	{
+		if (Entries[EntryIndex].IsValid())
+		{
+			SortedEntries.Add(EntryIndex);
+		}
+	}
+
+	SortedEntries.Sort([this](int32 A, int32 B) { return Entries[A].Rect.Left < Entries[B].Rect.Left; });
+
+	TArray<int32> SortedComments;
+	SortedComments.Reserve(CommentRects.Num());
+	for (int32 CommentIndex = 0; CommentIndex < CommentRects.Num(); ++CommentIndex)
+	{
+		SortedComments.Add(CommentIndex);
+	}
+
+	SortedComments.Sort([&CommentRects](int32 A, int32 B) { return CommentRects[A].Left < CommentRects[B].Left; });
+
+	const auto TestPair = [&](int32 CommentIndex, int32 EntryIndex)
+	{
+		const FASCSpatialEntry& Entry = Entries[EntryIndex];
+		if (DoesCollide(CollisionMethod, CommentRects[CommentIndex], Entry.Rect))
+		{
+			if (UEdGraphNode* Node = Entry.Node.Get())
+			{
+				OutNodesPerComment[CommentIndex].Add(Node);
+			}
+		}
+	};
+
+	// sweep from left to right, each pair is tested when the second of the two rects starts
+	// while the first is still active (has not ended before that point)
+	TArray<int32> ActiveComments;
+	TArray<int32> ActiveEntries;
+	int32 NextComment = 0;
+	int32 NextEntry = 0;
+
+	while (NextComment < SortedComments.Num() || NextEntry < SortedEntries.Num())
+	{
+		const bool bCommentsDone = NextComment >= SortedComments.Num() && ActiveComments.Num() == 0;
+		const bool bEntriesDone = NextEntry >= SortedEntries.Num() && ActiveEntries.Num() == 0;
+		if (bCommentsDone || bEntriesDone)
+		{
+			break;
+		}
+
+		const bool bTakeComment = NextEntry >= SortedEntries.Num() ||
+			(NextComment < SortedComments.Num() && CommentRects[SortedComments[NextComment]].Left <= Entries[SortedEntries[NextEntry]].Rect.Left);
+
+		if (bTakeComment)
+		{
+			const int32 CommentIndex = SortedComments[NextComment++];
+			const float SweepX = CommentRects[CommentIndex].Left;
+
+			for (int32 ActiveIndex = ActiveEntries.Num() - 1; ActiveIndex >= 0; --ActiveIndex)
+			{
+				if (GetEntryRight(ActiveEntries[ActiveIndex]) < SweepX)
+				{
+					ActiveEntries.RemoveAtSwap(ActiveIndex);
+				}
+				else
+				{
+					TestPair(CommentIndex, ActiveEntries[ActiveIndex]);
+				}
+			}
+
+			ActiveComments.Add(CommentIndex);
+		}
+		else
+		{
+			const int32 EntryIndex = SortedEntries[NextEntry++];
+			const float SweepX = Entries[EntryIndex].Rect.Left;
+
+			for (int32 ActiveIndex = ActiveComments.Num() - 1; ActiveIndex >= 0; --ActiveIndex)
+			{
+				if (CommentRects[ActiveComments[ActiveIndex]].Right < SweepX)
+				{
+					ActiveComments.RemoveAtSwap(ActiveIndex);
+				}
+				else
+				{
+					TestPair(ActiveComments[ActiveIndex], EntryIndex);
+				}
+			}
+
+			ActiveEntries.Add(EntryIndex);
+		}
+	}
+}
+
+void FASCNodeSpatialIndex::QueryComments(const FSlateRect& Rect, TArray<UEdGraphNode_Comment*>& OutComments) const
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCNodeSpatialIndex::QueryComments"), STAT_ASC_SpatialIndexQueryComments, STATGROUP_AutoSizeComments);
+
+	TArray<int32> Candidates;
+	GatherCandidates(Rect, Candidates);
+
+	++QueryStamp;
+	for (int32 EntryIndex : Candidates)
+	{
+		const FASCSpatialEntry& Entry = Entries[EntryIndex];
+		if (Entry.QueryStamp == QueryStamp || !Entry.IsValid())
+		{
+			continue;
+		}
+
+		Entry.QueryStamp = QueryStamp;
+
+		if (UEdGraphNode_Comment* Comment = Cast<UEdGraphNode_Comment>(Entry.Node.Get()))
+		{
+			if (FSlateRect::DoRectanglesIntersect(Rect, Entry.Rect))
+			{
+				OutComments.Add(Comment);
+			}
+		}
+	}
+}
+
+bool FASCNodeSpatialIndex::FindNodeRect(const UEdGraphNode* Node, FSlateRect& OutRect) const
+{
+	if (const int32* FoundIndex = NodeToEntry.Find(FObjectKey(Node)))
+	{
+		OutRect = Entries[*FoundIndex].Rect;
+		return true;
+	}
+
+	return false;
+}
+
+bool FASCNodeSpatialIndex::DoesCollide(ECommentCollisionMethod CollisionMethod, const FSlateRect& CommentRect, const FSlateRect& NodeRect)
+{
+	bool bIsOverlapping = false;
+
+	switch (CollisionMethod)
+	{
+		case ECommentCollisionMethod::Point:
+			bIsOverlapping = CommentRect.ContainsPoint(NodeRect.GetTopLeft());
+			break;
+		case ECommentCollisionMethod::Intersect:
+			CommentRect.IntersectionWith(NodeRect, bIsOverlapping);
+			break;
+		case ECommentCollisionMethod::Contained:
+			bIsOverlapping = FSlateRect::IsRectangleContained(CommentRect, NodeRect);
+			break;
+		default: ;
+	}
+
+	return bIsOverlapping;
+}
+
+FSlateRect FASCNodeSpatialIndex::GetNodeWidgetRect(const SGraphNode& NodeWidget)
+{
+	const FASCVector2 NodePosition = FASCUtils::GetNodePos(&NodeWidget);
+	const FASCVector2 NodeSize = NodeWidget.GetDesiredSize();
+	return FSlateRect::FromPointAndExtent(NodePosition, NodeSize);
+}
+
+void FASCNodeSpatialIndex::SubtractRect(const FSlateRect& Rect, const FSlateRect& Hole, TArray<FSlateRect>& OutRects)
+{
+	bool bOverlapping = false;
+	const FSlateRect Intersection = Rect.IntersectionWith(Hole, bOverlapping);
+	if (!bOverlapping)
+	{
+		OutRects.Add(Rect);
+		return;
+	}
+
+	// full width strips above and below the hole
+	if (Intersection.Top > Rect.Top)
+	{
+		OutRects.Add(FSlateRect(Rect.Left, Rect.Top, Rect.Right, Intersection.Top));
+	}
+
+	if (Intersection.Bottom < Rect.Bottom)
+	{
+		OutRects.Add(FSlateRect(Rect.Left, Intersection.Bottom, Rect.Right, Rect.Bottom));
+	}
+
+	// strips to the left and right of the hole
+	if (Intersection.Left > Rect.Left)
+	{
+		OutRects.Add(FSlateRect(Rect.Left, Intersection.Top, Intersection.Left, Intersection.Bottom));
+	}
+
+	if (Intersection.Right < Rect.Right)
+	{
+		OutRects.Add(FSlateRect(Intersection.Right, Intersection.Top, Rect.Right, Intersection.Bottom));
+	}
+}
+
+void FASCNodeSpatialIndex::Reset()
+{
+	Entries.Reset();
+	FreeEntries.Reset();
+	NodeToEntry.Reset();
+	MovedNodes.Reset();
+	SpatialHash.Reset();
+	BoundsTree.Reset();
+	RectBuffer.Reset();
+	LastNumChildren = INDEX_NONE;
+	bDirty = true;
+}
+
+int32 FASCNodeSpatialIndex::AddEntry(UEdGraphNode* Node, const TSharedRef<SGraphNode>& NodeWidget, const FSlateRect& Rect)
+{
+	const int32 EntryIndex = FreeEntries.Num() > 0 ? FreeEntries.Pop() : Entries.AddDefaulted();
+
+	FASCSpatialEntry& Entry = Entries[EntryIndex];
+	Entry.NodeKey = FObjectKey(Node);
+	Entry.Widget = NodeWidget;
+	Entry.Node = Node;
+	Entry.Rect = Rect;
+	Entry.RefreshStamp = RefreshStamp;
+
+	NodeToEntry.Add(Entry.NodeKey, EntryIndex);
+	RectBuffer.SetRect(EntryIndex, Rect);
+
+	switch (Method)
+	{
+		case EASCSpatialIndexMethod::Grid:
+			SpatialHash.Insert(EntryIndex, Rect);
+			break;
+		case EASCSpatialIndexMethod::BoundsTree:
+			Entry.ProxyId = BoundsTree.Insert(EntryIndex, Rect);
+			break;
+		default: ;
+	}
+
+	return EntryIndex;
+}
+
+void FASCNodeSpatialIndex::RemoveEntry(int32 EntryIndex)
+{
+	FASCSpatialEntry& Entry = Entries[EntryIndex];
+
+	switch (Method)
+	{
+		case EASCSpatialIndexMethod::Grid:
+			SpatialHash.Remove(EntryIndex, Entry.Rect);
+			break;
+		case EASCSpatialIndexMethod::BoundsTree:
+			BoundsTree.Remove(Entry.ProxyId);
+			break;
+		default: ;
+	}
+
+	NodeToEntry.Remove(Entry.NodeKey);
+	RectBuffer.ClearRect(EntryIndex);
+
+	Entry = FASCSpatialEntry();
+	FreeEntries.Add(EntryIndex);
+}
+
+void FASCNodeSpatialIndex::UpdateEntryRect(int32 EntryIndex, const FSlateRect& NewRect)
+{
+	FASCSpatialEntry& Entry = Entries[EntryIndex];
+
+	switch (Method)
+	{
+		case EASCSpatialIndexMethod::Grid:
+			SpatialHash.Update(EntryIndex, Entry.Rect, NewRect);
+			break;
+		case EASCSpatialIndexMethod::BoundsTree:
+			BoundsTree.Move(Entry.ProxyId, NewRect);
+			break;
+		default: ;
+	}
+
+	Entry.Rect = NewRect;
+	RectBuffer.SetRect(EntryIndex, NewRect);
+}
+
+void FASCNodeSpatialIndex::GatherCandidates(const FSlateRect& Rect, TArray<int32>& OutEntries) const
+{
+	if (ShouldTestAllEntries(Rect))
+	{
+		for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); ++EntryIndex)
+		{
+			OutEntries.Add(EntryIndex);
+		}
+
+		return;
+	}
+
+	switch (Method)
+	{
+		case EASCSpatialIndexMethod::Grid:
+			SpatialHash.Query(Rect, OutEntries);
+			break;
+		case EASCSpatialIndexMethod::BoundsTree:
+			BoundsTree.Query(Rect, OutEntries);
+			break;
+		default: ;
+	}
+}
+
+bool FASCNodeSpatialIndex::ShouldTestAllEntries(const FSlateRect& Rect) const
+{
+	switch (Method)
+	{
+		case EASCSpatialIndexMethod::Grid:
+			// the rect covers more cells than we have nodes, it is cheaper to test every node
+			return SpatialHash.GetNumCells(Rect) > Entries.Num();
+		case EASCSpatialIndexMethod::Linear:
+			return true;
+		default:
+			return false;
+	}
+}
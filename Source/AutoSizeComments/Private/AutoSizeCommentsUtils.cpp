@@ -1,6 +1,7 @@
 #include "AutoSizeCommentsUtils.h"
 
 #include "AutoSizeCommentsCacheFile.h"
+#include "AutoSizeCommentsGraphHandler.h"
 #include "AutoSizeCommentsGraphNode.h"
 #include "EdGraphNode_Comment.h"
 #include "SGraphPanel.h"
@@ -88,18 +89,7 @@ TArray<UEdGraphNode_Comment*> FASCUtils::GetCommentsFromGraph(UEdGraph* Graph)
 
 bool FASCUtils::HasNodeBeenDeleted(UEdGraphNode* Node)
 {
-	if (Node == nullptr)
-	{
-		return true;
-	}
-
-	UEdGraph* Graph = Node->GetGraph();
-	if (!Graph)
-	{
-		return true;
-	}
-
-	return !Graph->Nodes.Contains(Node);
+	return !FAutoSizeCommentGraphHandler::Get().IsNodeOnGraph(Node);
 }
 
 bool FASCUtils::IsValidPin(UEdGraphPin* Pin)
@@ -335,6 +325,14 @@ TSharedPtr<SWidget> FASCUtils::GetParentWidgetOfTypes(TSharedPtr<SWidget> Widget
 bool FASCUtils::DoesCommentContainComment(UEdGraphNode_Comment* Source, UEdGraphNode_Comment* Other)
 {
 	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCUtils::DoesCommentContainComment"), STAT_ASC_DoesCommentContainComment, STATGROUP_AutoSizeComments);
+
+	// use the cached nesting for graphs handled by the graph handler
+	bool bContains = false;
+	if (FAutoSizeCommentGraphHandler::Get().TryGetCommentContainsComment(Source, Other, bContains))
+	{
+		return bContains;
+	}
+
 	struct FLocal
 	{
 		static bool DoesCommentContainComment_Recursive(UEdGraphNode_Comment* Source, UEdGraphNode_Comment* Other, TSet<UEdGraphNode*>& Visited)
@@ -379,7 +377,13 @@ void FASCUtils::ClearCommentNodes(UEdGraphNode_Comment* Comment, bool bUpdateCac
 		return;
 	}
 
+	for (UObject* Obj : Comment->GetNodesUnderComment())
+	{
+		FAutoSizeCommentGraphHandler::Get().OnNodeRemovedFromComment(Comment, Obj);
+	}
+
 	Comment->ClearNodesUnderComment();
+	FAutoSizeCommentGraphHandler::Get().MarkCommentDirty(Comment);
 
 	if (bUpdateCache)
 	{
@@ -400,40 +404,9 @@ bool FASCUtils::RemoveNodesFromComment(UEdGraphNode_Comment* Comment, const TSet
 		return false;
 	}
 
-	const FCommentNodeSet NodesUnderComment = Comment->GetNodesUnderComment();
-
-	// don't do anything if we have nothing to remove
-	const bool bRemoveSomething = NodesUnderComment.ContainsByPredicate([&NodesToRemove](const UObject* Obj)
-	{
-		return NodesToRemove.Contains(Obj);
-	});
-
-	if (!bRemoveSomething)
-	{
-		return false;
-	}
-
-	// Clear all nodes under comment
-	Comment->ClearNodesUnderComment();
-
-	// Add back the nodes under comment while filtering out any which are to be removed
-	for (UObject* NodeUnderComment : NodesUnderComment)
-	{
-		if (NodeUnderComment)
-		{
-			if (!NodesToRemove.Contains(NodeUnderComment))
-			{
-				AddNodeIntoComment(Comment, NodeUnderComment, false);
-			}
-		}
-	}
-
-	if (bUpdateCache)
-	{
-		FAutoSizeCommentsCacheFile::Get().UpdateNodesUnderComment(Comment);
-	}
-
-	return true;
+	FASCCommentNodesEdit Edit(Comment);
+	Edit.Remove(NodesToRemove);
+	return Edit.Commit(bUpdateCache);
 }
 
 bool FASCUtils::AddNodeIntoComment(UEdGraphNode_Comment* Comment, UObject* NewNode, bool bUpdateCache)
@@ -460,6 +433,8 @@ bool FASCUtils::AddNodeIntoComment(UEdGraphNode_Comment* Comment, UObject* NewNo
 	}
 
 	Comment->AddNodeUnderComment(NewNode);
+	FAutoSizeCommentGraphHandler::Get().OnNodeAddedToComment(Comment, NewNode);
+	FAutoSizeCommentGraphHandler::Get().MarkCommentDirty(Comment);
 
 	if (bUpdateCache)
 	{
@@ -477,11 +452,123 @@ bool FASCUtils::AddNodesIntoComment(UEdGraphNode_Comment* Comment, const TSet<UO
 		return false;
 	}
 
+	FASCCommentNodesEdit Edit(Comment);
+	for (UObject* Node : NewNodes)
+	{
+		Edit.Add(Node);
+	}
+
+	Edit.Commit(bUpdateCache);
+	return true;
+}
+
+FASCCommentNodesEdit::FASCCommentNodesEdit(UEdGraphNode_Comment* InComment)
+	: Comment(InComment)
+{
+	if (Comment)
+	{
+		Nodes = Comment->GetNodesUnderComment();
+		NodeSet.Append(Nodes);
+	}
+}
+
+void FASCCommentNodesEdit::Add(UObject* Node)
+{
+	if (!Node || Node == Comment)
+	{
+		return;
+	}
+
+	bool bAlreadyInSet = false;
+	NodeSet.Add(Node, &bAlreadyInSet);
+	if (!bAlreadyInSet)
+	{
+		Nodes.Add(Node);
+	}
+}
+
+void FASCCommentNodesEdit::Remove(UObject* Node)
+{
+	NodeSet.Remove(Node);
+}
+
+void FASCCommentNodesEdit::Remove(const TSet<UObject*>& InNodes)
+{
+	for (UObject* Node : InNodes)
+	{
+		NodeSet.Remove(Node);
+	}
+}
+
+void FASCCommentNodesEdit::Clear()
+{
+	Nodes.Reset();
+	NodeSet.Reset();
+}
+
+bool FASCCommentNodesEdit::Commit(bool bUpdateCache)
+{
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("FASCCommentNodesEdit::Commit"), STAT_ASC_CommitCommentNodesEdit, STATGROUP_AutoSizeComments);
+	if (!Comment)
+	{
+		return false;
+	}
+
+	const FCommentNodeSet OldNodes = Comment->GetNodesUnderComment();
+	const TSet<UObject*> OldNodeSet(OldNodes);
+
+	TArray<UObject*> NewNodes;
+	TSet<UObject*> NewNodeSet;
+	NewNodes.Reserve(NodeSet.Num());
+	NewNodeSet.Reserve(NodeSet.Num());
+	for (UObject* Node : Nodes)
+	{
+		if (!Node || !NodeSet.Contains(Node) || NewNodeSet.Contains(Node))
+		{
+			continue;
+		}
+
+		// don't add comment if the comment contains us, nodes already under the comment have been checked before
+		if (!OldNodeSet.Contains(Node))
+		{
+			UEdGraphNode_Comment* NewComment = Cast<UEdGraphNode_Comment>(Node);
+			if (NewComment && FASCUtils::DoesCommentContainComment(NewComment, Comment))
+			{
+				continue;
+			}
+		}
+
+		NewNodes.Add(Node);
+		NewNodeSet.Add(Node);
+	}
+
+	// nothing changed, don't touch the comment
+	if (NewNodes.Num() == OldNodeSet.Num() && OldNodeSet.Includes(NewNodeSet))
+	{
+		return false;
+	}
+
+	FAutoSizeCommentGraphHandler& GraphHandler = FAutoSizeCommentGraphHandler::Get();
+	for (UObject* Obj : OldNodes)
+	{
+		if (!NewNodeSet.Contains(Obj))
+		{
+			GraphHandler.OnNodeRemovedFromComment(Comment, Obj);
+		}
+	}
+
+	Comment->ClearNodesUnderComment();
 	for (UObject* Node : NewNodes)
 	{
-		FASCUtils::AddNodeIntoComment(Comment, Node, false);
+		Comment->AddNodeUnderComment(Node);
+		if (!OldNodeSet.Contains(Node))
+		{
+			GraphHandler.OnNodeAddedToComment(Comment, Node);
+		}
 	}
 
+	GraphHandler.MarkCommentDirty(Comment);
+
 	if (bUpdateCache)
 	{
 		FAutoSizeCommentsCacheFile::Get().UpdateNodesUnderComment(Comment);
@@ -3,11 +3,17 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "AutoSizeCommentsMacros.h"
 #include "SGraphPin.h"
+#include "AssetRegistry/AssetData.h"
+#include "Async/Future.h"
+#include "Containers/Ticker.h"
+#include "GenericPlatform/GenericPlatformFile.h"
 #include "AutoSizeCommentsCacheFile.generated.h"
 
 class UEdGraphNode_Comment;
 class SAutoSizeCommentsGraphNode;
+enum class EASCCacheFileFormat : uint8;
 
 USTRUCT()
 struct AUTOSIZECOMMENTS_API FASCCommentData
@@ -24,7 +30,8 @@ struct AUTOSIZECOMMENTS_API FASCCommentData
 	void SetInitialized(bool bValue) { bInit = bValue != 0; }
 	bool HasBeenInitialized() const { return static_cast<bool>(bInit); }
 
-	void UpdateNodesUnderComment(UEdGraphNode_Comment* Comment);
+	/** @return true if the nodes under the comment changed */
+	bool UpdateNodesUnderComment(UEdGraphNode_Comment* Comment);
 
 private:
 	/* Is this node a header node */
@@ -46,7 +53,11 @@ struct AUTOSIZECOMMENTS_API FASCGraphData
 
 	bool bInitialized = false;
 
-	void CleanupGraph(UEdGraph* Graph);
+	/** Nodes have been removed from the graph since the last cleanup */
+	bool bNeedsCleanup = true;
+
+	/** @return true if any data was removed */
+	bool CleanupGraph(UEdGraph* Graph);
 
 	bool LoadFromPackageMetaData(UEdGraph* Graph);
 	void SaveToPackageMetaData(UEdGraph* Graph);
@@ -74,6 +85,51 @@ struct AUTOSIZECOMMENTS_API FASCCacheData
 	TMap<FName, FASCPackageData> PackageData; // package -> graph data
 };
 
+/** Cache files to write (or delete), captured on the game thread and written on a background task */
+struct FASCCacheSaveJob
+{
+	struct FFile
+	{
+		FString Path;
+		FASCCacheData Data;
+
+		/** Package written to the file, none for the single cache file */
+		FName PackageName;
+	};
+
+	/** What failed to save, handed back to the game thread so it is saved again */
+	struct FResult
+	{
+		/** Packages whose file failed to write, none if the single cache file failed */
+		TArray<FName> FailedPackages;
+
+		/** Journals kept because a file failed to write, to be deleted by the next save */
+		TArray<FString> KeptJournals;
+
+		bool bFailedShardIndex = false;
+	};
+
+	TArray<FFile> FilesToWrite;
+	TArray<FString> FilesToDelete;
+
+	/** Journals folded into the written files, only deleted if every file was written */
+	TArray<FString> JournalsToDelete;
+
+	/** Names of the packages with a per package cache file, written when the path is set */
+	FString ShardIndexPath;
+	TArray<FString> ShardIndex;
+
+	EASCCacheFileFormat Format;
+	FString FormatName;
+	FString OtherFormatName;
+	bool bPrettyPrintJson = false;
+
+	/** Also time serializing the cache in the other format, for the log */
+	bool bCompareOtherFormat = false;
+
+	FResult Run() const;
+};
+
 class AUTOSIZECOMMENTS_API FAutoSizeCommentsCacheFile
 {
 public:
@@ -94,13 +150,30 @@ public:
 
 	void InitMetaData();
 
+	/** Move the cache data over when the per package cache file setting changes, so the next save writes every package in the new layout */
+	void SyncSplitCacheFileMode();
+
+	/** Snapshot the cache and write it on a background task */
 	void SaveCacheToFile();
 
+	/** Wait for any cache save still being written */
+	void FlushPendingSave();
+
 	void DeleteCache();
 
+	/** Check the packages in the cache still exist, spread over the next ticks */
 	void CleanupFiles();
 
-	void UpdateNodesUnderComment(UEdGraphNode_Comment* Comment) { GetCommentData(Comment).UpdateNodesUnderComment(Comment); }
+	void UpdateNodesUnderComment(UEdGraphNode_Comment* Comment);
+
+	/** The cache data of the comment changed, its package will be written on the next save */
+	void MarkCommentDirty(UEdGraphNode* Comment);
+
+	/** The cache data of the graph changed (or was removed), its package will be written on the next save */
+	void MarkDirty(UEdGraph* Graph);
+
+	/** Nodes were removed from the graph, its cache data will be cleaned up on the next save */
+	void MarkNeedsCleanup(UEdGraph* Graph);
 
 	FASCCommentData& GetCommentData(UEdGraphNode_Comment* Comment);
 	FASCGraphData& GetGraphData(UEdGraph* Graph);
@@ -114,6 +187,29 @@ public:
 	FString GetCachePath(bool bFullPath = false);
 	FString GetAlternateCachePath(bool bFullPath = false);
 
+	/** The cache path with the extension for the format */
+	static FString GetCachePathForFormat(const FString& CachePath, EASCCacheFileFormat Format);
+
+	/** Journal of the changes made since the cache files were last written, next to the cache file */
+	static FString GetJournalPath(const FString& CachePath);
+	FString GetJournalPath() { return GetJournalPath(GetCachePath()); }
+
+	/** Journals left by compactions which didn't finish (oldest first), followed by the journal */
+	static void FindJournalFiles(const FString& JournalPath, TArray<FString>& OutPaths);
+
+	/** Folder of the per package cache files */
+	FString GetShardDirectory();
+	FString GetShardPath(FName PackageName, EASCCacheFileFormat Format);
+
+	static bool SerializeCacheData(const FASCCacheData& Data, EASCCacheFileFormat Format, TArray<uint8>& OutBytes, bool bPrettyPrintJson = false);
+
+	/**
+	 * Write to a temp file and rename it over the cache file, so a failed write never leaves a partial cache file.
+	 * The rename removes the old file first, a temp file without a cache file is recovered by LoadCacheFile.
+	 */
+	static bool WriteFileAtomic(const FString& Path, const TArray<uint8>& Bytes);
+	static bool DeserializeCacheData(const TArray<uint8>& Bytes, EASCCacheFileFormat Format, FASCCacheData& OutData);
+
 	bool GetNodesUnderComment(TSharedPtr<SAutoSizeCommentsGraphNode> ASCNode, TArray<UEdGraphNode*>& OutNodesUnderComment);
 
 	FASCCommentData& GetCommentData(UEdGraphNode* CommentNode);
@@ -125,9 +221,96 @@ public:
 protected:
 	FASCGraphData& GetCacheFileGraphData(UEdGraph* Graph);
 
+	/** The graph data in the cache file, without creating it or loading its package file */
+	FASCGraphData* FindCacheFileGraphData(UEdGraph* Graph);
+
+	void MarkPackageRemoved(FName PackageName);
+
+	void AppendGraphJournalRecord(FName PackageName, const FGuid& GraphGuid, const FASCGraphData& GraphData);
+
+	bool ShouldUseJournal() const;
+
+	void AppendJournalRecord(const TArray<uint8>& Payload);
+
+	/** Stop using the journal, the dirty packages are written by the next save instead */
+	void OnJournalFailed(const TCHAR* Operation);
+
+	/** Apply the journals left by the last session */
+	void ReplayJournals(FASCCacheData& Data, bool bTrackChanges);
+
+	int64 GetJournalSize();
+
 	bool bHasLoaded = false;
 
 	FASCCacheData CacheData;
 
+	/** Load the first cache file found, preferring the current location and format */
+	bool LoadCacheData(FASCCacheData& OutData);
+
+	/** @param bRecoverTempFile only safe while no save is writing the file */
+	static bool LoadCacheFile(const FString& CachePath, EASCCacheFileFormat Format, FASCCacheData& OutData, ELogVerbosity::Type Verbosity = ELogVerbosity::Log, bool bRecoverTempFile = true);
+
+	/** Load the cache file of the package the first time it is used */
+	void LoadPackageShard(FName PackageName);
+
+	/** Paths of the per package cache files in either format */
+	void FindShardFiles(TArray<FString>& OutPaths);
+
+	/** Load every per package cache file, used when switching back to a single cache file */
+	void LoadAllShards(FASCCacheData& OutData);
+
+	TFuture<FASCCacheSaveJob::FResult> PendingSave;
+
+	/** Packages changed since the last save */
+	TSet<FName> DirtyPackages;
+
+	/** Write every package on the next save, set when migrating from another cache file */
+	bool bAllPackagesDirty = false;
+
+	TUniquePtr<IFileHandle> JournalHandle;
+
+	/** The journal couldn't be written this session */
+	bool bJournalFailed = false;
+
+	/** Journals replayed on load, deleted once their changes have been written */
+	TArray<FString> ReplayedJournals;
+
+	/** The cache data is loaded per package, CacheData only holds the packages used so far */
+	bool bCacheDataSplit = false;
+
+	/** Packages whose cache file has been loaded (or found missing) */
+	TSet<FName> LoadedShards;
+
 	void OnPreExit();
+
+	/** Check the package in the asset registry on a later tick, removing its data if it no longer exists */
+	void QueuePackageCleanup(FName PackageName);
+
+	void StartCleanupTicker();
+
+	bool TickPackageCleanup(float DeltaTime);
+
+	void OnAssetRemoved(const FAssetData& AssetData);
+	void OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath);
+
+	TSet<FName> PackagesToCleanup;
+
+	/** Package files whose package name still needs reading into the index, when there was no index to load */
+	TArray<FString> ShardFilesToCleanup;
+
+	/** Packages with a per package cache file, so the cleanup doesn't need to open every package file */
+	TSet<FName> ShardIndex;
+
+	/** The index lists every package file (loaded from the index file or read from the package files), it is only written once complete */
+	bool bShardIndexComplete = false;
+	bool bShardIndexDirty = false;
+
+	FString GetShardIndexPath();
+	void LoadShardIndex();
+
+#if ASC_UE_VERSION_OR_LATER(5, 0)
+	FTSTicker::FDelegateHandle CleanupTickerHandle;
+#else
+	FDelegateHandle CleanupTickerHandle;
+#endif
 };
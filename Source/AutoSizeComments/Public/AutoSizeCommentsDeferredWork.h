@@ -0,0 +1,56 @@
+// Copyright fpwong. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/TimerHandle.h"
+
+enum class EASCDeferredWork : uint8
+{
+	InitializeComment,
+	NodeAdded,
+	UpdateContainingComments,
+	GraphVisualRefresh,
+	GraphPanelUpdate,
+	ResetAltReleased,
+	SaveSizeCache,
+};
+
+/**
+ * Runs work on the next tick as a single batch, instead of setting a timer for each request.
+ * Requests with the same kind and key are coalesced, only the last request's delegate is run
+ * (so a key reused by a new object after the old one was destroyed runs the new object's work).
+ */
+class FASCDeferredWork
+{
+public:
+	static FASCDeferredWork& Get();
+	static void TearDown();
+
+	/** Key is only used to coalesce requests (usually the object or widget the work is for) */
+	void Request(EASCDeferredWork Kind, const void* Key, FSimpleDelegate Work);
+
+	void Cleanup();
+
+	uint64 GetNumRequested() const { return NumRequested; }
+	uint64 GetNumCoalesced() const { return NumCoalesced; }
+
+private:
+	struct FPendingWork
+	{
+		EASCDeferredWork Kind;
+		const void* Key;
+		FSimpleDelegate Work;
+	};
+
+	void RunPendingWork();
+
+	TArray<FPendingWork> PendingWork;
+	/** Index into PendingWork of each pending kind and key */
+	TMap<TPair<uint8, const void*>, int32> PendingKeys;
+
+	FTimerHandle TimerHandle;
+
+	uint64 NumRequested = 0;
+	uint64 NumCoalesced = 0;
+};
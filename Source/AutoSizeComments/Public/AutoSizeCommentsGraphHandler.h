@@ -5,21 +5,161 @@
 #include "AutoSizeCommentsCacheFile.h"
 #include "AutoSizeCommentsMacros.h"
 #include "AutoSizeCommentsNodeChangeData.h"
+#include "AutoSizeCommentsSpatialIndex.h"
+#include "UObject/ObjectKey.h"
 
 enum class EASCResizingMode : uint8;
 class UEdGraphNode_Comment;
+class SAutoSizeCommentsGraphNode;
 class SGraphPanel;
+struct FPropertyChangedEvent;
+
+enum class EASCResizeWork : uint8
+{
+	InitialDetectNodes,
+	ResizeToFit,
+};
+
+struct FASCResizeRequest
+{
+	TWeakPtr<SAutoSizeCommentsGraphNode> Comment;
+	EASCResizeWork Work;
+};
+
+/**
+ * Nodes on a graph, kept in sync from the graph changed actions so liveness checks do not need to scan Graph->Nodes.
+ * Resynced when marked stale or when the graph's node count no longer matches (not every change has a callback).
+ */
+struct FASCLiveNodeSet
+{
+	TSet<FObjectKey> Nodes;
+
+	/** Used to resolve the node guids stored in the cache file */
+	TMap<FGuid, TWeakObjectPtr<UEdGraphNode>> NodesByGuid;
+
+	/** Nodes added since the last lookup, the engine only assigns the final guid after notifying the graph */
+	TArray<TWeakObjectPtr<UEdGraphNode>> NodesPendingGuid;
+
+	/** Generation the guid map was last rebuilt at after a lookup missed */
+	uint32 GuidMissGeneration = 0;
+
+	/** Bumped whenever the set changes, so comments only re-validate their nodes after a change */
+	uint32 Generation = 1;
+
+	int32 NumGraphNodes = 0;
+	bool bStale = true;
+
+	void Rebuild(UEdGraph* Graph);
+	void ApplyGraphAction(const FEdGraphEditAction& Action);
+
+	/** @return the node with the guid, the guid map is rebuilt (once per generation) before reporting a miss */
+	UEdGraphNode* FindNodeByGuid(UEdGraph* Graph, const FGuid& NodeGuid);
+};
+
+/**
+ * Reverse index of the nodes under each comment (node -> comments containing it).
+ * Kept in sync by FASCUtils when editing the nodes under a comment, rebuilt when marked stale.
+ */
+struct FASCContainmentIndex
+{
+	TMultiMap<FObjectKey, TWeakObjectPtr<UEdGraphNode_Comment>> NodeToComments;
+
+	bool bStale = true;
+
+	void Rebuild(UEdGraph* Graph);
+
+	void AddComment(UEdGraphNode_Comment* Comment);
+	void RemoveComment(UEdGraphNode_Comment* Comment);
+
+	/** Add or remove the comments being added to or deleted from the graph */
+	void ApplyGraphAction(const FEdGraphEditAction& Action);
+};
+
+/**
+ * Transitive closure of the comment nesting, one bitset per comment of the comments nested (at any depth) under it.
+ * Adding a comment into another updates the rows of the parent and its ancestors in place, removing one marks those rows dirty.
+ */
+struct FASCCommentReachability
+{
+	TMap<FObjectKey, int32> CommentIndices;
+	TArray<TWeakObjectPtr<UEdGraphNode_Comment>> Comments;
+
+	/** Bit j of row i is set if comment j is nested under comment i */
+	TArray<TBitArray<>> Descendants;
+
+	/** Rows which may still contain removed nesting, recalculated when next queried */
+	TBitArray<> DirtyRows;
+
+	/** Comments directly containing each comment, walked to find the ancestors of a comment */
+	TArray<TArray<int32>> DirectParents;
+
+	bool bStale = true;
+
+	void Rebuild(UEdGraph* Graph);
+
+	void OnNestingAdded(UEdGraphNode_Comment* Parent, UEdGraphNode_Comment* Child);
+	void OnNestingRemoved(UEdGraphNode_Comment* Parent, UEdGraphNode_Comment* Child);
+
+	/** @return false if either comment is missing from the index */
+	bool TryGetContains(UEdGraphNode_Comment* Source, UEdGraphNode_Comment* Other, bool& bOutContains);
+
+private:
+	void UpdateRow(int32 Row);
+
+	/** The row followed by the rows of every comment it is nested under */
+	void GetSelfAndAncestors(int32 Row, TArray<int32>& OutRows) const;
+};
+
+/**
+ * Nodes shown as related while comments are selected or dragged, every other node on the graph is shown as unrelated.
+ * Once active, only the nodes whose state differs from the previous set are written.
+ */
+struct FASCNodeHighlight
+{
+	TSet<TWeakObjectPtr<UEdGraphNode>> RelatedNodes;
+	bool bActive = false;
+
+	void SetRelatedNodes(UEdGraph* Graph, const TSet<UEdGraphNode*>& NewRelatedNodes);
+	void SetNodeRelated(UEdGraphNode* Node, bool bRelated);
+
+	/** Show every node as related */
+	void Reset(UEdGraph* Graph);
+};
 
 struct FASCGraphHandlerData
 {
 	TArray<TWeakObjectPtr<UEdGraphNode_Comment>> LastSelectionSet;
+	FASCNodeHighlight Highlight;
 	FDelegateHandle OnGraphChangedHandle;
 
 	TMap<FGuid, FASCCommentChangeData> CommentChangeData;
+	FASCNodeChangeCache NodeChangeCache;
 	FASCGraphData GraphCacheData;
 
 	TArray<TWeakObjectPtr<UEdGraphNode_Comment>> InitialComments;
 
+	FASCNodeSpatialIndex SpatialIndex;
+
+	FASCLiveNodeSet LiveNodes;
+
+	FASCContainmentIndex ContainmentIndex;
+
+	FASCCommentReachability CommentReachability;
+
+	/** Comments which should check if they need resizing on their next tick */
+	TSet<FGuid> DirtyComments;
+
+	/** Bumped when every comment on the graph should check if they need resizing */
+	uint32 DirtyGeneration = 1;
+
+	/** A selected node and its position last tick, the selection is only being dragged once it moves */
+	TWeakObjectPtr<UEdGraphNode> DragProbeNode;
+	FIntPoint DragProbePos = FIntPoint::ZeroValue;
+
+	/** Round robin position in Graph->Nodes for the fallback change poll */
+	int32 PollNodeIndex = 0;
+	float PollNodeProgress = 0.0f;
+
 	float LastZoomLevel = -1;
 	EGraphRenderingLOD::Type LastLOD = EGraphRenderingLOD::Type::DefaultDetail;
 };
@@ -50,6 +190,45 @@ public:
 	bool HasCommentChangeState(UEdGraphNode_Comment* Comment) const;
 	bool HasCommentChanged(UEdGraphNode_Comment* Comment);
 
+	/** Queue work for a comment, the queue is processed within the per-frame budget (selected and visible comments first) */
+	void QueueResizeWork(TSharedPtr<SAutoSizeCommentsGraphNode> Comment, EASCResizeWork Work);
+
+	/**
+	 * Resize the comment on the next tick. Comments requested in the same frame (and the comments containing them)
+	 * are resized from the innermost comment outwards so nested comments reach their final size in a single pass
+	 */
+	void RequestResizeToFit(TSharedPtr<SAutoSizeCommentsGraphNode> Comment);
+
+	/** Comments only check for changes after being marked dirty by one of these */
+	void MarkCommentDirty(UEdGraphNode_Comment* Comment);
+	void MarkContainingCommentsDirty(UEdGraphNode* Node);
+	void MarkGraphDirty(UEdGraph* Graph);
+
+	/** @return true if the comment was marked dirty since it last consumed, clearing the dirty state */
+	bool ConsumeCommentDirty(UEdGraphNode_Comment* Comment, uint32& InOutDirtyGeneration);
+
+	/** @return false if the node is null or has been removed from its graph */
+	bool IsNodeOnGraph(UEdGraphNode* Node);
+
+	/** Generation of the live node set, changes whenever a node is added to or removed from the graph */
+	uint32 GetLiveNodeGeneration(UEdGraph* Graph);
+
+	/** @return the node on the graph with the guid, or null if there is none */
+	UEdGraphNode* FindNodeByGuid(UEdGraph* Graph, const FGuid& NodeGuid);
+
+	/** Comments containing the node, looked up from the reverse containment index */
+	TArray<UEdGraphNode_Comment*> GetContainingComments(UEdGraphNode* Node);
+
+	/** Keep the containment index in sync, called by FASCUtils when editing the nodes under a comment */
+	void OnNodeAddedToComment(UEdGraphNode_Comment* Comment, UObject* Node);
+	void OnNodeRemovedFromComment(UEdGraphNode_Comment* Comment, UObject* Node);
+
+	/** @return false if the graph is not handled, otherwise OutContains is set if Other is nested anywhere under Source */
+	bool TryGetCommentContainsComment(UEdGraphNode_Comment* Source, UEdGraphNode_Comment* Other, bool& bOutContains);
+
+	/** Spatial index for the nodes displayed on the graph panel, refreshed before returning */
+	FASCNodeSpatialIndex& GetSpatialIndex(TSharedPtr<SGraphPanel> GraphPanel);
+
 	TArray<UEdGraph*> GetActiveGraphs();
 	TArray<TSharedPtr<SGraphPanel>> GetActiveGraphPanels();
 
@@ -57,6 +236,14 @@ public:
 
 	void ClearUnrelatedNodes();
 
+	/** Show the nodes as related and the rest of the graph as unrelated */
+	void SetNodesRelated(UEdGraph* Graph, const TSet<UEdGraphNode*>& Nodes);
+	void SetNodeRelated(UEdGraphNode* Node, bool bRelated);
+	void ResetNodesUnrelated(UEdGraph* Graph);
+
+	/** Check the selection of the active graph panels on the next tick */
+	void MarkSelectionDirty() { bSelectionDirty = true; }
+
 	void ClearGraphData();
 
 private:
@@ -70,16 +257,34 @@ private:
 	FDelegateHandle TickDelegateHandle;
 #endif
 
-	bool bPendingSave = false;
+	bool bProcessedAltReleased = false;
 
-	bool bPendingGraphVisualRequest = false;
+	bool bSelectionDirty = true;
 
-	bool bProcessedAltReleased = false;
+	TArray<FASCResizeRequest> ResizeQueue;
+	/** Index in the resize queue of the request for each widget and work */
+	TMap<TPair<const SAutoSizeCommentsGraphNode*, uint8>, int32> QueuedResizeWork;
+
+	TArray<TWeakPtr<SAutoSizeCommentsGraphNode>> PendingResizes;
 
 	bool Tick(float DeltaTime);
 
 	void UpdateNodeUnrelatedState();
 
+	/** Mark comments dirty for any nodes being moved by the mouse */
+	void MarkDraggedNodesDirty();
+
+	void ProcessResizeQueue();
+
+	/** Live nodes for a graph we are handling, resynced first if needed */
+	FASCLiveNodeSet* FindLiveNodes(UEdGraph* Graph);
+
+	/** Containment index for a graph we are handling, rebuilt first if needed */
+	FASCContainmentIndex* FindContainmentIndex(UEdGraph* Graph);
+
+	void ResizePendingComments();
+	void ResizeCommentsBottomUp(UEdGraph* Graph, const TSet<UEdGraphNode_Comment*>& RequestedComments);
+
 	void OnNodeAdded(TWeakObjectPtr<UEdGraphNode> NewNodePtr);
 
 	void OnNodeDeleted(const FEdGraphEditAction& Action);
@@ -92,6 +297,13 @@ private:
 
 	void OnObjectTransacted(UObject* Object, const FTransactionObjectEvent& Event);
 
+	void OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& Event);
+
+	void OnBlueprintCompiled();
+
+	/** Mark the next slice of comments on the graph dirty, so every comment is checked once per ChangePollInterval */
+	void PollCommentsForChanges(UEdGraph* Graph, FASCGraphHandlerData& GraphData, float DeltaTime);
+
 	void OnPostGarbageCollect();
 
 	void SaveSizeCache();
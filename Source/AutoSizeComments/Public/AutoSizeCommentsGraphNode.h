@@ -35,6 +35,19 @@ enum class EASCAnchorPoint : uint8
 	None
 };
 
+/** Parent / child comment edges changed by SAutoSizeCommentsGraphNode::UpdateExistingCommentNodes */
+struct FASCNestingChanges
+{
+	/** Pairs of (parent, child) */
+	TArray<TPair<UEdGraphNode_Comment*, UEdGraphNode_Comment*>> Added;
+	TArray<TPair<UEdGraphNode_Comment*, UEdGraphNode_Comment*>> Removed;
+
+	bool IsEmpty() const { return Added.Num() == 0 && Removed.Num() == 0; }
+
+	/** Comments which gained or lost a child comment */
+	TSet<UEdGraphNode_Comment*> GetChangedParents() const;
+};
+
 class SAutoSizeCommentsGraphNode final : public SGraphNode
 {
 public:
@@ -50,6 +63,10 @@ public:
 	FASCVector2 DragSize;
 	bool bUserIsDragging = false;
 
+	/** Nodes under the comment while resize dragging, only the area between the previous and current rect is queried on move */
+	TSet<UEdGraphNode*> DragNodesUnderComment;
+	TOptional<FSlateRect> LastDragQueryRect;
+
 	EASCAnchorPoint CachedAnchorPoint = EASCAnchorPoint::None;
 
 	bool bWasCopyPasted = false;
@@ -110,8 +127,12 @@ public:
 
 	FASCCommentData& GetCommentData() const;
 
-	void ResizeToFit();
-	void ResizeToFit_Impl();
+	/** @return true if the comment was moved or resized */
+	bool ResizeToFit();
+	bool ResizeToFit_Impl();
+
+	/** Add the nodes found inside the comment, called by the resize queue */
+	void InitialDetectNodes();
 
 	void ApplyHeaderStyle();
 	void ApplyPresetStyle(const FPresetCommentStyle& Style);
@@ -139,7 +160,6 @@ protected:
 
 	void InitializeASCNode(const TArray<TWeakObjectPtr<UObject>>& InitialSelectedNodes);
 	void InitializeNodesUnderComment(const TArray<TWeakObjectPtr<UObject>>& InitialSelectedNodes);
-	void InitialDetectNodes();
 
 	bool AddAllSelectedNodes(bool bExpandComments = false);
 	bool RemoveAllSelectedNodes(bool bExpandComments = false);
@@ -169,6 +189,9 @@ private:
 
 	void MoveEmptyCommentBoxes();
 
+	/** Update the unrelated state of the nodes entering or leaving the comment while resize dragging */
+	void UpdateDragNodesRelated();
+
 	void CreateCommentControls();
 	void CreateColorControls();
 
@@ -209,6 +232,11 @@ private:
 
 	bool bInitialized = false;
 
+	/** Last dirty generation of the graph we have checked for changes */
+	uint32 LastDirtyGeneration = 0;
+
+	uint32 LastLiveNodeGeneration = 0;
+
 	// TODO: Look into resize transaction perhaps requires the EdGraphNode_Comment to have UPROPERTY() for NodesUnderComment
 	// TSharedPtr<FScopedTransaction> ResizeTransaction;
 
@@ -236,8 +264,9 @@ public:
 	FSlateRect GetNodeBounds(UEdGraphNode* Node);
 	TSet<TSharedPtr<SAutoSizeCommentsGraphNode>> GetOtherCommentNodes();
 	TArray<UEdGraphNode_Comment*> GetParentComments() const;
-	void UpdateExistingCommentNodes(const TArray<UEdGraphNode_Comment*>* OldParentComments, const TArray<UObject*>* OldCommentContains);
-	void UpdateExistingCommentNodes();
+	FASCNestingChanges UpdateExistingCommentNodes(const TArray<UEdGraphNode_Comment*>* OldParentComments, const TArray<UObject*>* OldCommentContains);
+	FASCNestingChanges UpdateExistingCommentNodes();
+	TArray<UEdGraphNode_Comment*> GetChildComments() const;
 	bool AnySelectedNodes();
 	static FSlateRect GetCommentBounds(UEdGraphNode_Comment* InCommentNode);
 	void SnapVectorToGrid(FASCVector2& Vector);
@@ -260,6 +289,9 @@ public:
 	void QueryNodesUnderComment(TArray<UEdGraphNode*>& OutNodesUnderComment, const ECommentCollisionMethod OverrideCollisionMethod, const bool bIgnoreKnots = false);
 	void QueryNodesUnderComment(TArray<TSharedPtr<SGraphNode>>& OutNodesUnderComment, const ECommentCollisionMethod OverrideCollisionMethod, const bool bIgnoreKnots = false);
 
+	/** The comment body (excluding the title bar) used when checking for colliding nodes */
+	FSlateRect GetCommentCollisionRect() const;
+
 	void RandomizeColor();
 
 	void AdjustMinSize(FASCVector2& InSize);
@@ -21,6 +21,12 @@
 #define ASC_GET_FONT_STYLE FEditorStyle::GetFontStyle
 #endif
 
+#if ASC_UE_VERSION_OR_LATER(5, 0)
+using FASCVectorRegister = VectorRegister4Float;
+#else
+using FASCVectorRegister = VectorRegister;
+#endif
+
 #if ASC_UE_VERSION_OR_LATER(5, 6)
 using FASCMetaData = class FMetaData;
 using FASCVector2 = FVector2f;
@@ -29,45 +29,95 @@ struct FASCPinChangeData
 };
 
 
+/** Full record of the node, only stored when bDebugNodeChanges is enabled so we can log what changed */
+struct FASCNodeChangeDebugData
+{
+	TMap<FGuid, FASCPinChangeData> PinChangeData;
+	bool bCommentBubblePinned;
+	FString NodeTitle;
+	bool AdvancedPinDisplay;
+	ENodeEnabledState NodeEnabledState;
+	int32 NodeX;
+	int32 NodeY;
+	FName DelegateFunctionName;
+
+	void UpdateNode(UEdGraphNode* Node);
+
+	void LogChanges(UEdGraphNode* Node);
+};
+
 /**
  * @brief Node can change by:
  *		- Pin being linked
  *		- Pin value changing
  *		- Pin being added or removed
  *		- Expanding the node (see print string)
- *		- Node title changing
+ *		- Node comment changing
  *		- Comment bubble pinned
  */
 class FASCNodeChangeData
 {
-	TMap<FGuid, FASCPinChangeData> PinChangeData;
-	bool bCommentBubblePinned;
-	FString NodeTitle;
-	bool AdvancedPinDisplay;
-	ENodeEnabledState NodeEnabledState;
-	int32 NodeX;
-	int32 NodeY;
-	FName DelegateFunctionName;
+	/** Hash of the node's position, pins and state (see CalculateNodeHash), so checking for changes is a single compare */
+	uint64 NodeHash = 0;
+
+	/** Cache generation NodeHash was calculated in, 0 when invalidated */
+	uint32 HashGeneration = 0;
+
+	TSharedPtr<FASCNodeChangeDebugData> DebugData;
 
 public:
 	FASCNodeChangeData() = default;
 
-	void UpdateNode(UEdGraphNode* Node);
+	/** Hash of the node, only recalculated after it was invalidated or the generation changed */
+	uint64 GetNodeHash(UEdGraphNode* Node, uint32 Generation);
+
+	void Invalidate() { HashGeneration = 0; }
+
+	/** Log what changed since the last log (when bDebugNodeChanges is enabled) */
+	void LogChanges(UEdGraphNode* Node);
+
+	static uint64 CalculateNodeHash(UEdGraphNode* Node);
+};
+
+/** Node change data for a graph, shared by every comment so nested comments do not each evaluate the same node */
+class FASCNodeChangeCache
+{
+	TMap<TWeakObjectPtr<UEdGraphNode>, FASCNodeChangeData> NodeChangeData;
+
+	/** Bumped by InvalidateAll, so every cached hash is recalculated on its next lookup */
+	uint32 Generation = 1;
+
+public:
+	uint64 GetNodeHash(UEdGraphNode* Node);
+
+	/** Recalculate the node's hash on its next lookup, call this when the node is notified as changed */
+	void Invalidate(UEdGraphNode* Node);
 
-	bool HasNodeChanged(UEdGraphNode* Node);
+	/** Recalculate every hash on its next lookup, for changes which were not notified per node */
+	void InvalidateAll();
+
+	void LogChanges(UEdGraphNode* Node);
+
+	/** Remove the data for nodes which have been destroyed */
+	void RemoveStaleNodes();
 };
 
 class FASCCommentChangeData
 {
 	FString NodeComment;
-	TMap<TWeakObjectPtr<UEdGraphNode>, FASCNodeChangeData> NodeChangeData;
+
+	/** Node hashes when the comment was last updated */
+	TMap<TWeakObjectPtr<UEdGraphNode>, uint64> NodeHashes;
 
 public:
 	FASCCommentChangeData() = default;
 
-	void UpdateComment(UEdGraphNode_Comment* Comment);
+	void UpdateComment(UEdGraphNode_Comment* Comment, FASCNodeChangeCache& NodeChangeCache);
+
+	bool HasCommentChanged(UEdGraphNode_Comment* Comment, FASCNodeChangeCache& NodeChangeCache);
 
-	bool HasCommentChanged(UEdGraphNode_Comment* Comment);
+	/** Invalidate the hashes of the nodes recorded for this comment */
+	void InvalidateNodes(FASCNodeChangeCache& NodeChangeCache);
 
 	void DebugPrint();
 };
\ No newline at end of file
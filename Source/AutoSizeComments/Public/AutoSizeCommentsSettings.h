@@ -29,6 +29,16 @@ enum class EASCCacheSaveLocation : uint8
 	Project UMETA(DisplayName = "Project"),
 };
 
+UENUM()
+enum class EASCCacheFileFormat : uint8
+{
+	/** Human-readable json (.json) */
+	Json UMETA(DisplayName = "Json"),
+
+	/** Compact versioned binary (.ascbin), much smaller and faster to read and write */
+	Binary UMETA(DisplayName = "Binary"),
+};
+
 UENUM()
 enum class EASCResizingMode : uint8
 {
@@ -56,6 +66,19 @@ enum class ECommentCollisionMethod : uint8
 	Disabled UMETA(DisplayName = "Disabled"),
 };
 
+UENUM()
+enum class EASCSpatialIndexMethod : uint8
+{
+	/** Store node bounds in a uniform grid (best for graphs with similar sized nodes) */
+	Grid UMETA(DisplayName = "Grid"),
+
+	/** Store node bounds in a dynamic bounding volume tree (best for graphs mixing very large and small nodes) */
+	BoundsTree UMETA(DisplayName = "Bounds Tree"),
+
+	/** Test the bounds of every node using vectorized instructions (best for small graphs) */
+	Linear UMETA(DisplayName = "Linear"),
+};
+
 UENUM()
 enum class EASCAutoInsertComment : uint8
 {
@@ -213,11 +236,19 @@ public:
 	UPROPERTY(EditAnywhere, config, Category = Misc)
 	EASCResizingMode ResizingMode;
 
+	/** Time (in milliseconds) each frame spent detecting nodes and resizing queued comments, selected and visible comments go first (0: unlimited) */
+	UPROPERTY(EditAnywhere, config, Category = Misc, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0", UIMax = "16"))
+	float ResizeQueueBudgetMs;
+
+	/** Comments are checked for changes when notified by the editor, as a fallback slowly cycle through every comment over this many seconds (0: disabled) */
+	UPROPERTY(EditAnywhere, config, Category = Misc, AdvancedDisplay, meta = (ClampMin = "0", UIMin = "0", UIMax = "10"))
+	float ChangePollInterval;
+
 	/** Should the comment resize to fit after running user commands in disabled mode */
     UPROPERTY(EditAnywhere, config, Category = Misc, meta = (EditCondition = "ResizingMode == EASCResizingMode::Disabled", EditConditionHides))
     bool ResizeToFitWhenDisabled;
 
-	/** In reactive mode, run a 2nd resize so that the title is correctly calculated */
+	/** In reactive mode, run a 2nd resize after the width changes so that the wrapped title height is correctly calculated */
 	UPROPERTY(EditAnywhere, config, Category = Misc, meta = (EditCondition = "ResizingMode == EASCResizingMode::Reactive"))
 	bool bUseTwoPassResize;
 
@@ -261,6 +292,10 @@ public:
 	UPROPERTY(EditAnywhere, config, Category = Misc)
 	float EmptyCommentBoxSpeed;
 
+	/** Data structure used to find the nodes overlapping a comment */
+	UPROPERTY(EditAnywhere, config, Category = Misc, AdvancedDisplay)
+	EASCSpatialIndexMethod SpatialIndexMethod;
+
 	/** Choose cache save method: as an external file or inside the package's metadata */
 	UPROPERTY(EditAnywhere, config, Category = CommentCache)
 	EASCCacheSaveMethod CacheSaveMethod;
@@ -269,6 +304,22 @@ public:
 	UPROPERTY(EditAnywhere, config, Category = CommentCache, meta = (EditCondition = "CacheSaveMethod == EASCCacheSaveMethod::File", EditConditionHides))
 	EASCCacheSaveLocation CacheSaveLocation;
 
+	/** Format of the cache file, a cache file found in the other format is loaded and migrated on the next save */
+	UPROPERTY(EditAnywhere, config, Category = CommentCache, meta = (EditCondition = "CacheSaveMethod == EASCCacheSaveMethod::File", EditConditionHides))
+	EASCCacheFileFormat CacheFileFormat;
+
+	/** Save a small cache file per package which is only loaded when the package's graphs are opened, instead of one file for the whole project */
+	UPROPERTY(EditAnywhere, config, Category = CommentCache, meta = (EditCondition = "CacheSaveMethod == EASCCacheSaveMethod::File", EditConditionHides))
+	bool bSplitCacheFilePerPackage;
+
+	/** Append each change to a small journal file instead of rewriting the cache files when saving, the journal is folded into the cache files once it grows past CacheJournalCompactSize */
+	UPROPERTY(EditAnywhere, config, Category = CommentCache, meta = (EditCondition = "CacheSaveMethod == EASCCacheSaveMethod::File", EditConditionHides))
+	bool bUseCacheJournal;
+
+	/** Size of the cache journal (in KB) at which it is folded into the cache files on the next save */
+	UPROPERTY(EditAnywhere, config, Category = CommentCache, AdvancedDisplay, meta = (ClampMin = "1", UIMin = "1", UIMax = "4096", EditCondition = "CacheSaveMethod == EASCCacheSaveMethod::File && bUseCacheJournal", EditConditionHides))
+	int32 CacheJournalCompactSize;
+
 	/** If enabled, nodes will be saved to file when the graph is saved */
 	UPROPERTY(EditAnywhere, config, Category = CommentCache)
 	bool bSaveCommentDataOnSavingGraph;
@@ -404,6 +455,10 @@ public:
 	UPROPERTY(EditAnywhere, config, Category = Debug)
 	bool bDisablePackageCleanup;
 
+	/** Keep a full record of the nodes inside comments and log what changed when a comment resizes (uses more memory) */
+	UPROPERTY(EditAnywhere, config, Category = Debug)
+	bool bDebugNodeChanges;
+
 	/** Use the default Unreal comment node */
 	UPROPERTY(EditAnywhere, config, Category = Debug)
 	bool bDisableASCGraphNode;
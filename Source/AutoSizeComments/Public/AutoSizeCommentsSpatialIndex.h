@@ -0,0 +1,222 @@
+// Copyright fpwong. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AutoSizeCommentsMacros.h"
+#include "AutoSizeCommentsSettings.h"
+#include "Layout/SlateRect.h"
+#include "UObject/ObjectKey.h"
+
+class SGraphNode;
+class SGraphPanel;
+class UEdGraphNode;
+class UEdGraphNode_Comment;
+
+/**
+ * Uniform grid storing ids by the cells their rect overlaps (graph space)
+ */
+class FASCSpatialHash
+{
+public:
+	void Reset();
+
+	void Insert(int32 Id, const FSlateRect& Rect);
+	void Remove(int32 Id, const FSlateRect& Rect);
+	void Update(int32 Id, const FSlateRect& OldRect, const FSlateRect& NewRect);
+
+	/** Appends the ids of all cells overlapping the rect, the same id can be added more than once */
+	void Query(const FSlateRect& Rect, TArray<int32>& OutIds) const;
+
+	/** Number of cells the rect overlaps */
+	int64 GetNumCells(const FSlateRect& Rect) const;
+
+private:
+	static constexpr float CellSize = 512.0f;
+
+	void GetCellRange(const FSlateRect& Rect, FIntPoint& OutMin, FIntPoint& OutMax) const;
+
+	TMap<FIntPoint, TArray<int32>> Cells;
+};
+
+/**
+ * Dynamic AABB tree storing ids by their rect (graph space).
+ * Leaves store a fattened rect so small moves do not touch the tree, larger moves only
+ * reinsert the leaf and refit (and rebalance) its ancestors.
+ */
+class FASCAABBTree
+{
+public:
+	void Reset();
+
+	/** @return the proxy id of the new leaf */
+	int32 Insert(int32 Id, const FSlateRect& Rect);
+	void Remove(int32 ProxyId);
+
+	/** @return true if the leaf had to be reinserted */
+	bool Move(int32 ProxyId, const FSlateRect& NewRect);
+
+	/** Appends the ids of all leaves whose (fattened) rect overlaps the rect */
+	void Query(const FSlateRect& Rect, TArray<int32>& OutIds) const;
+
+	int32 GetHeight() const;
+
+private:
+	static constexpr float FatMargin = 32.0f;
+
+	struct FTreeNode
+	{
+		FSlateRect Bounds;
+		int32 Parent = INDEX_NONE;
+		int32 Child1 = INDEX_NONE;
+		int32 Child2 = INDEX_NONE;
+		int32 Height = 0;
+		int32 Id = INDEX_NONE;
+
+		bool IsLeaf() const { return Child1 == INDEX_NONE; }
+	};
+
+	int32 AllocateNode();
+	void FreeNode(int32 NodeIndex);
+
+	void InsertLeaf(int32 Leaf);
+	void RemoveLeaf(int32 Leaf);
+
+	/** Walk up from the node, rebalancing and updating the bounds of each ancestor */
+	void Refit(int32 NodeIndex);
+	int32 Balance(int32 NodeIndex);
+
+	static FSlateRect Union(const FSlateRect& A, const FSlateRect& B);
+	static float GetPerimeter(const FSlateRect& Rect);
+
+	TArray<FTreeNode> Nodes;
+	TArray<int32> FreeNodes;
+	int32 Root = INDEX_NONE;
+};
+
+/**
+ * Structure of arrays storing rects by index so they can be tested 4 at a time with vector instructions.
+ * Empty slots store a point at MAX_flt which never collides with a comment.
+ */
+class FASCRectBuffer
+{
+public:
+	void Reset();
+
+	void SetRect(int32 Index, const FSlateRect& Rect);
+	void ClearRect(int32 Index);
+
+	/** Number of slots (always a multiple of 4) */
+	int32 Num() const { return Left.Num(); }
+
+	/** Writes a bitmask (32 slots per word) of the slots colliding with the comment rect */
+	void TestCollisions(const FSlateRect& CommentRect, ECommentCollisionMethod CollisionMethod, TArray<uint32>& OutMask) const;
+
+private:
+	template <ECommentCollisionMethod CollisionMethod>
+	void TestCollisions_Impl(const FSlateRect& CommentRect, TArray<uint32>& OutMask) const;
+
+	TArray<float, TAlignedHeapAllocator<16>> Left;
+	TArray<float, TAlignedHeapAllocator<16>> Top;
+	TArray<float, TAlignedHeapAllocator<16>> Right;
+	TArray<float, TAlignedHeapAllocator<16>> Bottom;
+};
+
+struct FASCSpatialEntry
+{
+	/** Keyed by the node object, guids are not unique until a pasted node has been given a new one */
+	FObjectKey NodeKey;
+	TWeakPtr<SGraphNode> Widget;
+	TWeakObjectPtr<UEdGraphNode> Node;
+	FSlateRect Rect;
+
+	/** Leaf in the bounds tree */
+	int32 ProxyId = INDEX_NONE;
+
+	/** Stamp of the last refresh which found this node on the panel */
+	uint32 RefreshStamp = 0;
+
+	/** Used to skip duplicates when the node is stored in multiple cells */
+	mutable uint32 QueryStamp = 0;
+
+	bool IsValid() const { return NodeKey != FObjectKey(); }
+};
+
+/**
+ * Spatial index of the node widget rects on a graph panel.
+ * Every panel child is only walked when nodes were added or removed (the index is marked dirty), otherwise
+ * only the nodes notified as moved and the selection (which is what gets dragged) are revalidated, so
+ * comment collision queries only need to test the nodes near the comment.
+ */
+class FASCNodeSpatialIndex
+{
+public:
+	/** Update the stored rects of any node that has been added, moved, resized or removed */
+	void Refresh(TSharedPtr<SGraphPanel> GraphPanel);
+
+	void MarkDirty() { bDirty = true; }
+
+	/** Revalidate the node's rect on the next refresh, call this when a node is moved or resized */
+	void MarkNodeMoved(const UEdGraphNode* Node) { MovedNodes.Add(FObjectKey(Node)); }
+
+	/** Nodes colliding with the comment rect for the collision method */
+	void QueryNodes(const FSlateRect& CommentRect, ECommentCollisionMethod CollisionMethod, TArray<TSharedRef<SGraphNode>>& OutNodes) const;
+
+	/**
+	 * Nodes colliding with each of the comment rects, found with a single sweep over the rects sorted on X.
+	 * OutNodesPerComment has the same order as CommentRects.
+	 */
+	void SweepCollisions(const TArray<FSlateRect>& CommentRects, ECommentCollisionMethod CollisionMethod, TArray<TSet<UEdGraphNode*>>& OutNodesPerComment) const;
+
+	/** Comment nodes whose widget rect intersects the rect */
+	void QueryComments(const FSlateRect& Rect, TArray<UEdGraphNode_Comment*>& OutComments) const;
+
+	/** Widget rect of the node as of the last refresh */
+	bool FindNodeRect(const UEdGraphNode* Node, FSlateRect& OutRect) const;
+
+	static bool DoesCollide(ECommentCollisionMethod CollisionMethod, const FSlateRect& CommentRect, const FSlateRect& NodeRect);
+
+	static FSlateRect GetNodeWidgetRect(const SGraphNode& NodeWidget);
+
+	/** Appends up to 4 rects covering the area of the rect outside of the hole */
+	static void SubtractRect(const FSlateRect& Rect, const FSlateRect& Hole, TArray<FSlateRect>& OutRects);
+
+private:
+	void Reset();
+
+	/** Walk every node on the panel, adding, updating and removing entries */
+	void RefreshAll(TSharedPtr<SGraphPanel> GraphPanel, int32 NumChildren);
+
+	/** Update the rect of the node's entry, returns false if the widget is gone and the panel needs to be walked */
+	bool RevalidateNode(const FObjectKey& NodeKey);
+
+	int32 AddEntry(UEdGraphNode* Node, const TSharedRef<SGraphNode>& NodeWidget, const FSlateRect& Rect);
+	void RemoveEntry(int32 EntryIndex);
+	void UpdateEntryRect(int32 EntryIndex, const FSlateRect& NewRect);
+
+	/** Entries which may overlap the rect, the same entry can be added more than once */
+	void GatherCandidates(const FSlateRect& Rect, TArray<int32>& OutEntries) const;
+
+	/** Should we test every node using the rect buffer instead of looking up candidates */
+	bool ShouldTestAllEntries(const FSlateRect& Rect) const;
+
+	TArray<FASCSpatialEntry> Entries;
+	TArray<int32> FreeEntries;
+	TMap<FObjectKey, int32> NodeToEntry;
+
+	/** Nodes to revalidate on the next refresh, see MarkNodeMoved */
+	TSet<FObjectKey> MovedNodes;
+
+	FASCSpatialHash SpatialHash;
+	FASCAABBTree BoundsTree;
+	FASCRectBuffer RectBuffer;
+	EASCSpatialIndexMethod Method = EASCSpatialIndexMethod::BoundsTree;
+
+	TWeakPtr<SGraphPanel> OwnerPanel;
+
+	uint64 LastRefreshFrame = MAX_uint64;
+	int32 LastNumChildren = INDEX_NONE;
+	uint32 RefreshStamp = 0;
+	mutable uint32 QueryStamp = 0;
+	bool bDirty = true;
+};
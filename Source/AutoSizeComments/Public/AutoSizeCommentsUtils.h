@@ -57,3 +57,30 @@ struct FASCUtils
 
 	static FASCVector2 GetNodePos(const SGraphNode* Node);
 };
+
+/**
+ * Batches changes to the nodes under a comment so the final set is validated and written once on Commit.
+ * Only nodes which were not already under the comment are checked for nesting cycles, and the handler
+ * indices are only told about the nodes which were actually added or removed.
+ */
+struct FASCCommentNodesEdit
+{
+	explicit FASCCommentNodesEdit(UEdGraphNode_Comment* InComment);
+
+	void Add(UObject* Node);
+	void Remove(UObject* Node);
+	void Remove(const TSet<UObject*>& Nodes);
+
+	/** Start from an empty set instead of the current nodes under the comment */
+	void Clear();
+
+	/** @return true if the nodes under the comment changed */
+	bool Commit(bool bUpdateCache = true);
+
+private:
+	UEdGraphNode_Comment* Comment;
+
+	/** Nodes in the order they were added, may contain removed nodes which are skipped on commit */
+	TArray<UObject*> Nodes;
+	TSet<UObject*> NodeSet;
+};